@@ -0,0 +1,193 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file   auto_engine.c
+ *
+ * @brief  Picks between the device and the host for verify --engine
+ * auto.
+ *
+ * Which is faster depends on the board's CPU and on the bus, so each
+ * is timed once, on the RFC 6979 P-256 test vector, and the rates are
+ * kept in a small text file in the cache directory.  Both are timed
+ * below the verification cache, which would otherwise answer every
+ * run after the first:
+ *
+ *   HOSTNAME BUS ADDRESS DEVICE_RATE HOST_RATE
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "auto_engine.h"
+#include "cache_file.h"
+#include "../crypto/p256.h"
+#include "../driver/device_verify.h"
+#include <libcryptoauth.h>
+
+/* RFC 6979 A.2.5, P-256 with SHA-256 over "sample" */
+static const char *TEST_PUB_KEY =
+  "04"
+  "60FED4BA255A9D31C961EB74C6356D68C049B8923B61FA6CE669622E60F29FB6"
+  "7903FE1008B8BC99A41AE9E95628BC64F2F1B20C2D7E9F5177A3C294D4462299";
+static const char *TEST_SIGNATURE =
+  "EFD48B2AACB6A8FD1140DD9CD45E81D69D2C877B56AAF991C34D0EA84EAF3716"
+  "F7CB1C942D657C41D436C7A1B6E29F65F3E900DBB9AFF4064DC4AB2F843ACDA8";
+static const char *TEST_DIGEST =
+  "AF2BDBE1AA9B6EC1E2ADE1D694F41FC71A831D0268E9891562113D8A62ADD1BF";
+
+/**
+ * The "HOSTNAME BUS ADDRESS" a file line starts with.
+ */
+static void
+rates_key (const struct arguments *args, char *key, size_t len)
+{
+  char host[256];
+
+  if (0 != gethostname (host, sizeof (host)))
+    snprintf (host, sizeof (host), "%s", "localhost");
+
+  host[sizeof (host) - 1] = '\0';
+
+  snprintf (key, len, "%s %s %02X", host, args->bus, args->address);
+}
+
+bool
+engine_rates_load (const struct arguments *args, struct engine_rates *rates)
+{
+  char key[512];
+  char *value = NULL;
+  bool found = false;
+
+  assert (NULL != args);
+  assert (NULL != rates);
+
+  rates_key (args, key, sizeof (key));
+
+  if ((value = cache_file_lookup (AUTO_ENGINE_FILE, key)) != NULL)
+    {
+      found = 2 == sscanf (value, "%lf %lf", &rates->device, &rates->host);
+      free (value);
+    }
+
+  return found;
+}
+
+static void
+rates_store (const struct arguments *args, const struct engine_rates *rates)
+{
+  char key[512];
+  char value[64];
+
+  rates_key (args, key, sizeof (key));
+  snprintf (value, sizeof (value), "%.1f %.1f", rates->device, rates->host);
+
+  cache_file_replace (AUTO_ENGINE_FILE, key, value);
+}
+
+static double
+seconds_since (const struct timespec *start)
+{
+  struct timespec now;
+
+  clock_gettime (CLOCK_MONOTONIC, &now);
+
+  return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+void
+engine_rates_measure (int fd, const struct arguments *args,
+                      struct engine_rates *rates)
+{
+  struct lca_octet_buffer pub_key = lca_ascii_hex_2_bin (TEST_PUB_KEY, 130);
+  struct lca_octet_buffer signature = lca_ascii_hex_2_bin (TEST_SIGNATURE,
+                                                           128);
+  struct lca_octet_buffer digest = lca_ascii_hex_2_bin (TEST_DIGEST, 64);
+  struct device_verify_packet packet;
+  struct timespec start;
+  unsigned long count = 0;
+  double secs = 0;
+  unsigned int x = 0;
+
+  assert (NULL != args);
+  assert (NULL != rates);
+
+  rates->device = 0;
+  rates->host = 0;
+
+  device_verify_prepare (&packet, pub_key.ptr, signature.ptr, digest.ptr);
+
+  /* One untimed run wakes the device and warms the host's tables */
+  if (device_verify_send (fd, &packet))
+    {
+      clock_gettime (CLOCK_MONOTONIC, &start);
+
+      for (x = 0; x < AUTO_DEVICE_RUNS; x++)
+        if (!device_verify_send (fd, &packet))
+          break;
+
+      if (AUTO_DEVICE_RUNS == x)
+        rates->device = x / seconds_since (&start);
+    }
+
+  if (p256_verify (pub_key.ptr, signature.ptr, digest.ptr))
+    {
+      clock_gettime (CLOCK_MONOTONIC, &start);
+
+      do
+        {
+          if (!p256_verify (pub_key.ptr, signature.ptr, digest.ptr))
+            {
+              count = 0;
+              break;
+            }
+          count++;
+        }
+      while ((secs = seconds_since (&start)) < AUTO_HOST_NS / 1e9);
+
+      if (count > 0)
+        rates->host = count / secs;
+    }
+
+  LCA_LOG (DEBUG, "Measured %.1f verifies/s on the device, %.1f on the host",
+           rates->device, rates->host);
+
+  rates_store (args, rates);
+
+  lca_free_octet_buffer (digest);
+  lca_free_octet_buffer (signature);
+  lca_free_octet_buffer (pub_key);
+}
+
+bool
+verify_on_host (const struct arguments *args)
+{
+  struct engine_rates rates;
+
+  assert (NULL != args);
+
+  return NULL != args->engine && 0 == strcmp (args->engine, ENGINE_AUTO) &&
+    NULL == args->digest_list && !args->stored_key &&
+    engine_rates_load (args, &rates) && rates.host >= rates.device;
+}
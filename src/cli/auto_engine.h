@@ -0,0 +1,81 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AUTO_ENGINE_H
+#define AUTO_ENGINE_H
+
+#include <stdbool.h>
+#include "cli_commands.h"
+
+/* Measured rates, one line per host, bus and address */
+#define AUTO_ENGINE_FILE "engines"
+
+/* Device verifications timed, each takes tens of milliseconds */
+#define AUTO_DEVICE_RUNS 3
+
+/* How long the host verifier is timed */
+#define AUTO_HOST_NS 100000000LL
+
+/* A batch is only split when neither engine is this many times
+   faster, beyond that the slower one adds next to nothing */
+#define AUTO_SPLIT_MAX_RATIO 256
+
+/* Verifies per second of each engine, 0 when it can't verify */
+struct engine_rates
+{
+  double device;
+  double host;
+};
+
+/**
+ * The rates stored for this host and device.
+ *
+ * @param args The arguments, bus and address name the device
+ * @param rates Filled in when found
+ *
+ * @return false if they were never measured
+ */
+bool engine_rates_load (const struct arguments *args,
+                        struct engine_rates *rates);
+
+/**
+ * Time both engines on a known good signature and store the rates.
+ * The device and the p256 verifier are called directly, so neither
+ * the verification cache nor the keyring skews them.
+ *
+ * @param fd The open device
+ * @param args The arguments
+ * @param rates Filled with the rates
+ */
+void engine_rates_measure (int fd, const struct arguments *args,
+                           struct engine_rates *rates);
+
+/**
+ * Whether verify --engine auto will run a single verification, or a
+ * stream, on the host, in which case the device isn't opened at all.  Only stored
+ * rates count, so the first run opens the device to measure it.
+ *
+ * @param args The arguments
+ *
+ * @return true to verify on the host
+ */
+bool verify_on_host (const struct arguments *args);
+
+#endif /* AUTO_ENGINE_H */
@@ -0,0 +1,866 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "batch.h"
+#include "file_digest.h"
+#include "verify_cache.h"
+#include "work_queue.h"
+#include "../driver/device_verify.h"
+#include "../crypto/sha256_mb.h"
+#include <libcryptoauth.h>
+
+char *
+next_list_entry (FILE *list, char **line, size_t *n)
+{
+  ssize_t len;
+
+  assert (NULL != list);
+
+  while ((len = getline (line, n, list)) >= 0)
+    {
+      while (len > 0 && ('\n' == (*line)[len - 1] || '\r' == (*line)[len - 1]))
+        (*line)[--len] = '\0';
+
+      if (len > 0)
+        return *line;
+    }
+
+  return NULL;
+}
+
+static void
+output_entry (const char *name, struct lca_octet_buffer buf)
+{
+  fprintf (stdout, "%s\t", name);
+  output_hex (stdout, buf);
+}
+
+struct list_source
+{
+  FILE *list;
+  char *line;
+  size_t n;
+};
+
+struct digest_item
+{
+  char *path;
+  struct lca_octet_buffer digest;
+};
+
+static void *
+next_path (void *ctx)
+{
+  struct list_source *src = ctx;
+  const char *path = next_list_entry (src->list, &src->line, &src->n);
+
+  return NULL != path ? strdup (path) : NULL;
+}
+
+static void *
+hash_worker (void *ctx)
+{
+  struct work_queue *q = ctx;
+  unsigned int lanes = sha256_mb_lanes ();
+  unsigned int max = lanes > 1 ? lanes * BATCH_FILES_PER_LANE : 1;
+  unsigned long seqs[SHA256_MB_MAX_LANES * BATCH_FILES_PER_LANE];
+  void *inputs[SHA256_MB_MAX_LANES * BATCH_FILES_PER_LANE];
+  struct lca_octet_buffer digests[SHA256_MB_MAX_LANES * BATCH_FILES_PER_LANE];
+  unsigned int num = 0;
+  unsigned int x = 0;
+
+  while ((num = work_queue_claim_batch (q, max, seqs, inputs)) > 0)
+    {
+      digest_paths ((const char *const *)inputs, num, digests);
+
+      for (x = 0; x < num; x++)
+        {
+          struct digest_item *item = lca_malloc_wipe (sizeof (*item));
+
+          item->path = inputs[x];
+          item->digest = digests[x];
+
+          work_queue_publish (q, seqs[x], item);
+        }
+    }
+
+  return NULL;
+}
+
+bool
+digest_list (const char *list, unsigned int jobs, digest_callback cb,
+             void *ctx)
+{
+  bool result = true;
+  struct list_source src = { NULL, NULL, 0 };
+  struct work_queue *q = NULL;
+  pthread_t *workers = NULL;
+  unsigned int depth = 0;
+  unsigned int x = 0;
+  void *taken = NULL;
+
+  assert (NULL != list);
+  assert (NULL != cb);
+
+  if ((src.list = fopen (list, "r")) == NULL)
+    {
+      perror ("Failed to open batch list");
+      return false;
+    }
+
+  /* Worker threads hash ahead while the callback runs, so the slower
+     of the two sets the pace.  Each worker claims a group of files at
+     a time to fill the multi-buffer lanes. */
+  jobs = jobs > 0 ? jobs : default_jobs ();
+  depth = BATCH_QUEUE_DEPTH_PER_JOB * jobs;
+  if (sha256_mb_lanes () > 1)
+    depth *= sha256_mb_lanes () * BATCH_FILES_PER_LANE;
+  q = work_queue_new (depth, next_path, &src);
+  workers = lca_malloc_wipe (jobs * sizeof (pthread_t));
+
+  for (x = 0; x < jobs; x++)
+    if (0 != pthread_create (&workers[x], NULL, hash_worker, q))
+      break;
+
+  if (0 == (jobs = x))
+    {
+      /* Without workers there is nothing to drain the list */
+      fprintf (stderr, "%s\n", "Failed to start hash threads");
+      result = false;
+      q->drained = true;
+    }
+
+  while (work_queue_take (q, &taken))
+    {
+      struct digest_item *item = taken;
+
+      if (!cb (item->path, item->digest, ctx))
+        result = false;
+
+      if (NULL != item->digest.ptr)
+        lca_free_octet_buffer (item->digest);
+
+      free (item->path);
+      free (item);
+    }
+
+  for (x = 0; x < jobs; x++)
+    pthread_join (workers[x], NULL);
+
+  free (workers);
+  work_queue_free (q);
+  free (src.line);
+  fclose (src.list);
+
+  return result;
+}
+
+struct sign_ctx
+{
+  int fd;
+  unsigned int slot;
+};
+
+static bool
+sign_entry (const char *path, struct lca_octet_buffer digest, void *ctx)
+{
+  struct sign_ctx *sign = ctx;
+  struct lca_octet_buffer rsp = {0,0};
+
+  if (NULL == digest.ptr)
+    return false;
+
+  rsp = sign_digest (sign->fd, sign->slot, digest);
+
+  if (NULL == rsp.ptr)
+    {
+      fprintf (stderr, "%s: %s\n", path, "Sign Command failed.");
+      return false;
+    }
+
+  output_entry (path, rsp);
+  lca_free_octet_buffer (rsp);
+
+  return true;
+}
+
+int
+sign_batch (int fd, struct arguments *args)
+{
+  int result = HASHLET_COMMAND_FAIL;
+  struct sign_ctx ctx = { fd, 0 };
+
+  assert (NULL != args);
+  assert (NULL != args->batch);
+
+  ctx.slot = args->key_slot;
+
+  /* Update the seed once for the whole session instead of before
+     every signature */
+  struct lca_octet_buffer r = lca_get_random (fd, true);
+
+  if (digest_list (args->batch, args->jobs, sign_entry, &ctx))
+    result = HASHLET_COMMAND_SUCCESS;
+
+  lca_free_octet_buffer (r);
+
+  return result;
+}
+
+/**
+ * Split a digest list line into whitespace separated fields.
+ *
+ * @return The number of fields found, at most max
+ */
+static unsigned int
+split_fields (char *line, char **fields, unsigned int max)
+{
+  char *save = NULL;
+  unsigned int x = 0;
+
+  for (x = 0; x < max; x++)
+    if ((fields[x] = strtok_r (x == 0 ? line : NULL, " \t", &save)) == NULL)
+      break;
+
+  return x;
+}
+
+int
+sign_digest_list (int fd, struct arguments *args)
+{
+  int result = HASHLET_COMMAND_SUCCESS;
+  FILE *list = NULL;
+  char *line = NULL;
+  size_t n = 0;
+  char *entry = NULL;
+  unsigned long num = 0;
+
+  assert (NULL != args);
+  assert (NULL != args->digest_list);
+
+  if ((list = fopen (args->digest_list, "r")) == NULL)
+    {
+      perror ("Failed to open digest list");
+      return HASHLET_COMMAND_FAIL;
+    }
+
+  /* Update the seed once for the whole session instead of before
+     every signature */
+  struct lca_octet_buffer r = lca_get_random (fd, true);
+
+  while ((entry = next_list_entry (list, &line, &n)) != NULL)
+    {
+      char *fields[2];
+      unsigned int num_fields = split_fields (entry, fields, 2);
+      struct lca_octet_buffer digest = {0,0};
+      struct lca_octet_buffer rsp = {0,0};
+
+      num++;
+
+      if (num_fields < 1 || !is_hex_arg (fields[0], 64))
+        {
+          fprintf (stderr, "%s:%lu: %s\n", args->digest_list, num,
+                   "Invalid SHA256 Digest.");
+          result = HASHLET_COMMAND_FAIL;
+          continue;
+        }
+
+      digest = lca_ascii_hex_2_bin (fields[0], 64);
+      rsp = sign_digest (fd, args->key_slot, digest);
+
+      if (NULL != rsp.ptr)
+        {
+          output_entry (num_fields > 1 ? fields[1] : fields[0], rsp);
+          lca_free_octet_buffer (rsp);
+        }
+      else
+        {
+          fprintf (stderr, "%s: %s\n", fields[0], "Sign Command failed.");
+          result = HASHLET_COMMAND_FAIL;
+        }
+
+      lca_free_octet_buffer (digest);
+    }
+
+  lca_free_octet_buffer (r);
+  free (line);
+  fclose (list);
+
+  return result;
+}
+
+/**
+ * Decode a hex field of exactly 2 len characters without allocating.
+ */
+static bool
+hex_field (const char *hex, uint8_t *out, unsigned int len)
+{
+  unsigned int x = 0;
+
+  if (NULL == hex || !is_hex_arg (hex, 2 * len))
+    return false;
+
+  for (x = 0; x < 2 * len; x++)
+    {
+      char c = hex[x];
+      uint8_t v = c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+
+      out[x / 2] = x % 2 ? out[x / 2] | v : v << 4;
+    }
+
+  return true;
+}
+
+/* One digest list entry on its way to the device */
+struct pipeline_item
+{
+  char *line;
+  const char *name;             /**< Points into line */
+  bool valid;
+  bool cached;                  /**< Verified before, skip the device */
+  struct device_verify_packet packet;
+};
+
+struct pipeline_source
+{
+  FILE *list;
+  char *line;
+  size_t n;
+};
+
+struct pipeline_worker
+{
+  struct work_queue *q;
+  const uint8_t *pub_key;       /**< NULL for the stored key */
+  unsigned int key_slot;
+};
+
+static void *
+next_pipeline_item (void *ctx)
+{
+  struct pipeline_source *src = ctx;
+  struct pipeline_item *item = NULL;
+  const char *entry = next_list_entry (src->list, &src->line, &src->n);
+
+  if (NULL == entry)
+    return NULL;
+
+  item = lca_malloc_wipe (sizeof (*item));
+  item->line = strdup (entry);
+
+  return item;
+}
+
+/**
+ * Parse, decode and check the cache for each entry, so the device
+ * thread finds the next packet ready when the current one returns.
+ */
+static void *
+pipeline_worker (void *ctx)
+{
+  struct pipeline_worker *w = ctx;
+  unsigned long seq = 0;
+  void *input = NULL;
+
+  while (work_queue_claim (w->q, &seq, &input))
+    {
+      struct pipeline_item *item = input;
+      uint8_t digest[32], signature[64];
+      char *fields[3];
+      unsigned int num_fields = NULL != item->line ?
+        split_fields (item->line, fields, 3) : 0;
+
+      if (num_fields >= 2 && hex_field (fields[0], digest, sizeof (digest)) &&
+          hex_field (fields[1], signature, sizeof (signature)))
+        {
+          item->valid = true;
+          item->name = num_fields > 2 ? fields[2] : fields[0];
+          if (NULL == w->pub_key)
+            device_verify_prepare_stored (&item->packet, w->key_slot,
+                                          signature, digest);
+          else
+            {
+              item->cached = verify_cache_lookup (w->pub_key, digest,
+                                                  signature);
+              device_verify_prepare (&item->packet, w->pub_key, signature,
+                                     digest);
+            }
+        }
+
+      work_queue_publish (w->q, seq, item);
+    }
+
+  return NULL;
+}
+
+/**
+ * verify_digest_list on the device.  A worker thread prepares entries
+ * ahead while this thread keeps the device busy with back to back
+ * Nonce and Verify pairs.
+ */
+static int
+verify_digest_pipeline (int fd, struct arguments *args)
+{
+  int result = HASHLET_COMMAND_SUCCESS;
+  struct pipeline_source src = { NULL, NULL, 0 };
+  struct pipeline_worker w;
+  struct lca_octet_buffer pub_key = {0,0};
+  unsigned long num = 0;
+  pthread_t thread;
+  bool started = false;
+  void *taken = NULL;
+
+  if ((src.list = fopen (args->digest_list, "r")) == NULL)
+    {
+      perror ("Failed to open digest list");
+      return HASHLET_COMMAND_FAIL;
+    }
+
+  /* Without the key there is nothing to key the cache with either */
+  if (!args->stored_key)
+    pub_key = lca_ascii_hex_2_bin (args->pub_key, 130);
+
+  w.q = work_queue_new (BATCH_QUEUE_DEPTH_PER_JOB, next_pipeline_item, &src);
+  w.pub_key = pub_key.ptr;
+  w.key_slot = args->key_slot;
+
+  if (!(started = 0 == pthread_create (&thread, NULL, pipeline_worker, &w)))
+    {
+      fprintf (stderr, "%s\n", "Failed to start verify thread");
+      result = HASHLET_COMMAND_FAIL;
+      w.q->drained = true;
+    }
+
+  while (work_queue_take (w.q, &taken))
+    {
+      struct pipeline_item *item = taken;
+      bool verified = false;
+
+      num++;
+
+      if (!item->valid)
+        {
+          fprintf (stderr, "%s:%lu: %s\n", args->digest_list, num,
+                   "Expected DIGEST SIGNATURE [NAME]");
+          result = HASHLET_COMMAND_FAIL;
+        }
+      else
+        {
+          verified = item->cached || device_verify_send (fd, &item->packet);
+
+          if (verified && !item->cached && NULL != pub_key.ptr)
+            verify_cache_store (pub_key.ptr, item->packet.nonce,
+                                item->packet.verify);
+
+          fprintf (stdout, "%s\t%s\n", item->name, verified ? "OK" : "FAIL");
+
+          if (!verified)
+            result = HASHLET_COMMAND_FAIL;
+        }
+
+      free (item->line);
+      free (item);
+    }
+
+  if (started)
+    pthread_join (thread, NULL);
+
+  work_queue_free (w.q);
+  if (NULL != pub_key.ptr)
+    lca_free_octet_buffer (pub_key);
+  free (src.line);
+  fclose (src.list);
+
+  return result;
+}
+
+int
+verify_digest_list (int fd, struct arguments *args, bool offline)
+{
+  int result = HASHLET_COMMAND_SUCCESS;
+  FILE *list = NULL;
+  char *line = NULL;
+  size_t n = 0;
+  char *entry = NULL;
+  unsigned long num = 0;
+  struct lca_octet_buffer pub_key = {0,0};
+  offline_verifier verify = NULL;
+
+  assert (NULL != args);
+  assert (NULL != args->digest_list);
+  assert (NULL != args->pub_key || (args->stored_key && !offline));
+
+  if (!offline)
+    return verify_digest_pipeline (fd, args);
+
+  if ((verify = offline_engine (args)) == NULL)
+    return HASHLET_COMMAND_FAIL;
+
+  if ((list = fopen (args->digest_list, "r")) == NULL)
+    {
+      perror ("Failed to open digest list");
+      return HASHLET_COMMAND_FAIL;
+    }
+
+  pub_key = lca_ascii_hex_2_bin (args->pub_key, 130);
+
+  while ((entry = next_list_entry (list, &line, &n)) != NULL)
+    {
+      char *fields[3];
+      unsigned int num_fields = split_fields (entry, fields, 3);
+      struct lca_octet_buffer digest = {0,0};
+      struct lca_octet_buffer signature = {0,0};
+      bool verified = false;
+
+      num++;
+
+      if (num_fields < 2 || !is_hex_arg (fields[0], 64) ||
+          !is_hex_arg (fields[1], 128))
+        {
+          fprintf (stderr, "%s:%lu: %s\n", args->digest_list, num,
+                   "Expected DIGEST SIGNATURE [NAME]");
+          result = HASHLET_COMMAND_FAIL;
+          continue;
+        }
+
+      digest = lca_ascii_hex_2_bin (fields[0], 64);
+      signature = lca_ascii_hex_2_bin (fields[1], 128);
+
+      verified = verify (pub_key, signature, digest);
+
+      fprintf (stdout, "%s\t%s\n", num_fields > 2 ? fields[2] : fields[0],
+               verified ? "OK" : "FAIL");
+
+      if (!verified)
+        result = HASHLET_COMMAND_FAIL;
+
+      lca_free_octet_buffer (signature);
+      lca_free_octet_buffer (digest);
+    }
+
+  lca_free_octet_buffer (pub_key);
+  free (line);
+  fclose (list);
+
+  return result;
+}
+
+/**
+ * Answer one stream record.
+ *
+ * @return true if it verified
+ */
+static bool
+stream_record (int fd, offline_verifier verify, char *line)
+{
+  uint8_t digest[32], signature[64], pub_key[65];
+  struct lca_octet_buffer d = { digest, sizeof (digest) };
+  struct lca_octet_buffer s = { signature, sizeof (signature) };
+  struct lca_octet_buffer q = { pub_key, sizeof (pub_key) };
+  char *fields[4];
+  bool verified = false;
+
+  if (3 != split_fields (line, fields, 4) ||
+      !hex_field (fields[0], digest, sizeof (digest)) ||
+      !hex_field (fields[1], signature, sizeof (signature)) ||
+      !hex_field (fields[2], pub_key, sizeof (pub_key)))
+    {
+      fputs ("ERR usage: DIGEST SIGNATURE PUBLIC_KEY\n", stdout);
+      return false;
+    }
+
+  if (NULL != verify)
+    verified = verify (q, s, d);
+  else
+    verified = verify_digest (fd, q, s, d);
+
+  fputs (verified ? "OK\n" : "FAIL\n", stdout);
+
+  return verified;
+}
+
+int
+verify_stream (int fd, struct arguments *args, bool offline)
+{
+  int result = HASHLET_COMMAND_SUCCESS;
+  offline_verifier verify = NULL;
+  char *buf = NULL;
+  char *start = NULL;
+  char *nl = NULL;
+  size_t len = 0;
+  ssize_t n = 0;
+  bool skip = false;
+
+  assert (NULL != args);
+
+  if (offline && (verify = offline_engine (args)) == NULL)
+    return HASHLET_COMMAND_FAIL;
+
+  if ((buf = malloc (STREAM_BUF_LEN + 1)) == NULL)
+    return HASHLET_COMMAND_FAIL;
+
+  while (true)
+    {
+      if ((n = read (STDIN_FILENO, buf + len, STREAM_BUF_LEN - len)) < 0)
+        {
+          if (EINTR == errno)
+            continue;
+          perror ("stdin");
+          result = HASHLET_COMMAND_FAIL;
+          break;
+        }
+
+      len += n;
+      buf[len] = '\0';
+
+      /* A final record need not end with a newline */
+      if (0 == n && len > 0 && '\n' != buf[len - 1])
+        buf[len++] = '\n';
+
+      start = buf;
+      while ((nl = memchr (start, '\n', len - (start - buf))) != NULL)
+        {
+          char *end = nl;
+
+          *nl = '\0';
+          while (end > start && '\r' == end[-1])
+            *--end = '\0';
+
+          /* The tail of a record that was too long */
+          if (skip)
+            skip = false;
+          else if (end > start && !stream_record (fd, verify, start))
+            result = HASHLET_COMMAND_FAIL;
+
+          start = nl + 1;
+        }
+
+      len -= start - buf;
+      memmove (buf, start, len);
+
+      /* One answer per record, however many buffers it spans */
+      if (STREAM_BUF_LEN == len)
+        {
+          if (!skip)
+            {
+              fputs ("ERR record too long\n", stdout);
+              result = HASHLET_COMMAND_FAIL;
+            }
+          len = 0;
+          skip = true;
+        }
+
+      /* Everything read so far is answered, read may now block */
+      fflush (stdout);
+
+      if (0 == n)
+        break;
+    }
+
+  free (buf);
+
+  return result;
+}
+
+enum split_result
+  {
+    SPLIT_OK = 0,
+    SPLIT_FAIL,
+    SPLIT_INVALID
+  };
+
+struct split_item
+{
+  char *line;
+  const char *name;             /**< Points into line */
+  enum split_result result;
+  bool on_device;
+};
+
+struct split_source
+{
+  FILE *list;
+  char *line;
+  size_t n;
+};
+
+/* What one worker verifies with: the device when verify is NULL */
+struct split_worker
+{
+  struct work_queue *q;
+  int fd;
+  offline_verifier verify;
+  struct lca_octet_buffer pub_key;
+  pthread_t thread;
+};
+
+static void *
+next_split_item (void *ctx)
+{
+  struct split_source *src = ctx;
+  struct split_item *item = NULL;
+  const char *entry = next_list_entry (src->list, &src->line, &src->n);
+
+  if (NULL == entry)
+    return NULL;
+
+  item = lca_malloc_wipe (sizeof (*item));
+  item->line = strdup (entry);
+
+  return item;
+}
+
+static void *
+split_worker (void *ctx)
+{
+  struct split_worker *w = ctx;
+  unsigned long seq = 0;
+  void *input = NULL;
+
+  while (work_queue_claim (w->q, &seq, &input))
+    {
+      struct split_item *item = input;
+      uint8_t digest[32], signature[64];
+      struct lca_octet_buffer d = { digest, sizeof (digest) };
+      struct lca_octet_buffer s = { signature, sizeof (signature) };
+      char *fields[3];
+      unsigned int num_fields = NULL != item->line ?
+        split_fields (item->line, fields, 3) : 0;
+
+      if (num_fields < 2 || !hex_field (fields[0], digest, sizeof (digest)) ||
+          !hex_field (fields[1], signature, sizeof (signature)))
+        item->result = SPLIT_INVALID;
+      else
+        {
+          bool verified = NULL != w->verify ?
+            w->verify (w->pub_key, s, d) :
+            verify_digest (w->fd, w->pub_key, s, d);
+
+          item->name = num_fields > 2 ? fields[2] : fields[0];
+          item->result = verified ? SPLIT_OK : SPLIT_FAIL;
+          item->on_device = NULL == w->verify;
+        }
+
+      work_queue_publish (w->q, seq, item);
+    }
+
+  return NULL;
+}
+
+int
+verify_digest_list_split (int fd, struct arguments *args,
+                          offline_verifier verify, double ratio)
+{
+  int result = HASHLET_COMMAND_SUCCESS;
+  struct split_source src = { NULL, NULL, 0 };
+  struct split_worker *workers = NULL;
+  struct lca_octet_buffer pub_key = {0,0};
+  unsigned long num = 0, on_device = 0;
+  unsigned int jobs = 0;
+  unsigned int started = 0;
+  unsigned int x = 0;
+  struct work_queue *q = NULL;
+  void *taken = NULL;
+
+  assert (NULL != args);
+  assert (NULL != args->digest_list);
+  assert (NULL != args->pub_key);
+  assert (NULL != verify);
+
+  if ((src.list = fopen (args->digest_list, "r")) == NULL)
+    {
+      perror ("Failed to open digest list");
+      return HASHLET_COMMAND_FAIL;
+    }
+
+  pub_key = lca_ascii_hex_2_bin (args->pub_key, 130);
+
+  /* One worker drives the device, the rest verify on the host.  Each
+     claims the next entry when it is free, so the split follows
+     whichever is faster. */
+  jobs = 1 + (args->jobs > 0 ? args->jobs : default_jobs ());
+
+  /* Results are taken in order, so while the slower engine works on
+     one entry the faster one must have room for ratio more */
+  q = work_queue_new (jobs * (BATCH_QUEUE_DEPTH_PER_JOB +
+                              2 * ((unsigned int)ratio + 1)),
+                      next_split_item, &src);
+  workers = lca_malloc_wipe (jobs * sizeof (struct split_worker));
+
+  for (x = 0; x < jobs; x++)
+    {
+      workers[x].q = q;
+      workers[x].fd = fd;
+      workers[x].verify = 0 == x ? NULL : verify;
+      workers[x].pub_key = pub_key;
+
+      if (0 != pthread_create (&workers[x].thread, NULL, split_worker,
+                               &workers[x]))
+        break;
+    }
+
+  if (0 == (started = x))
+    {
+      fprintf (stderr, "%s\n", "Failed to start verify threads");
+      result = HASHLET_COMMAND_FAIL;
+      q->drained = true;
+    }
+
+  while (work_queue_take (q, &taken))
+    {
+      struct split_item *item = taken;
+
+      num++;
+
+      if (SPLIT_INVALID == item->result)
+        fprintf (stderr, "%s:%lu: %s\n", args->digest_list, num,
+                 "Expected DIGEST SIGNATURE [NAME]");
+      else
+        fprintf (stdout, "%s\t%s\n", item->name,
+                 SPLIT_OK == item->result ? "OK" : "FAIL");
+
+      if (SPLIT_OK != item->result)
+        result = HASHLET_COMMAND_FAIL;
+
+      if (item->on_device)
+        on_device++;
+
+      free (item->line);
+      free (item);
+    }
+
+  for (x = 0; x < started; x++)
+    pthread_join (workers[x].thread, NULL);
+
+  LCA_LOG (DEBUG, "%lu of %lu verified on the device", on_device, num);
+
+  free (workers);
+  work_queue_free (q);
+  lca_free_octet_buffer (pub_key);
+  free (src.line);
+  fclose (src.list);
+
+  return result;
+}
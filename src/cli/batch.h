@@ -0,0 +1,159 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+#include "cli_commands.h"
+
+/* Hashed results that may wait for the device, per worker thread */
+#define BATCH_QUEUE_DEPTH_PER_JOB 4
+
+/* Files a worker claims per multi-buffer lane, so lanes that finish
+   early are refilled instead of idling */
+#define BATCH_FILES_PER_LANE 2
+
+/* verify --stream reads stdin in chunks this large, and every line
+   must fit in one */
+#define STREAM_BUF_LEN 65536
+
+/**
+ * Read the next entry from a newline separated list.  Empty lines are
+ * skipped and the trailing newline is removed.
+ *
+ * @param list The open list file
+ * @param line The getline buffer, free it when done
+ * @param n The getline buffer size
+ *
+ * @return The entry, which points into line, or NULL at the end of
+ * the list.
+ */
+char *
+next_list_entry (FILE *list, char **line, size_t *n);
+
+/**
+ * Called in list order with the digest of each file.
+ *
+ * @param path The path from the list
+ * @param digest The SHA256 digest, a NULL buffer if the file could not
+ * be read.  It is freed after the callback returns.
+ * @param ctx The context given to digest_list
+ *
+ * @return false if the entry failed
+ */
+typedef bool (*digest_callback) (const char *path,
+                                 struct lca_octet_buffer digest, void *ctx);
+
+/**
+ * Hash every file named in a list on worker threads and hand the
+ * digests to the callback in list order.
+ *
+ * @param list The list file, one path per line
+ * @param jobs The number of worker threads, 0 for one per CPU
+ * @param cb The callback
+ * @param ctx Passed to the callback
+ *
+ * @return false if the list could not be read or any entry failed
+ */
+bool
+digest_list (const char *list, unsigned int jobs, digest_callback cb,
+             void *ctx);
+
+/**
+ * Sign every file named in the batch list using one device session.
+ * Worker threads hash the upcoming files while the device signs the
+ * current one.  Each signature is written to stdout, in list order, as
+ * path<TAB>signature.
+ *
+ * @param fd The open file descriptor
+ * @param args The arguments, batch names the list file
+ *
+ * @return Success if every file was signed
+ */
+int
+sign_batch (int fd, struct arguments *args);
+
+/**
+ * Sign every precomputed digest in the digest list using one device
+ * session.  Each line is DIGEST [NAME] and each signature is written
+ * to stdout as NAME<TAB>signature, or DIGEST<TAB>signature without a
+ * name.
+ *
+ * @param fd The open file descriptor
+ * @param args The arguments, digest_list names the list file
+ *
+ * @return Success if every digest was signed
+ */
+int
+sign_digest_list (int fd, struct arguments *args);
+
+/**
+ * Verify every DIGEST SIGNATURE [NAME] line of the digest list
+ * against the public key option.  One NAME<TAB>OK or NAME<TAB>FAIL
+ * line is written per entry.  On the device, a worker thread decodes
+ * the next entries while the device verifies the current one, so the
+ * device is never left waiting on the host.  With stored_key, the
+ * device checks against the key in the key slot instead.
+ *
+ * @param fd The open file descriptor
+ * @param args The arguments, digest_list names the list file
+ * @param offline Verify in software instead of on the device
+ *
+ * @return Success if every signature verified
+ */
+int
+verify_digest_list (int fd, struct arguments *args, bool offline);
+
+/**
+ * verify_digest_list split between the device and the host, for
+ * verify --engine auto.  One thread drives the device and the others
+ * (--jobs, one per CPU by default) verify on the host.  Output is the
+ * same, in list order.
+ *
+ * @param fd The open file descriptor
+ * @param args The arguments, digest_list names the list file
+ * @param verify The host verifier
+ * @param ratio How many times faster the faster engine is, which sets
+ * how far ahead of the slower one it may get
+ *
+ * @return Success if every signature verified
+ */
+int
+verify_digest_list_split (int fd, struct arguments *args,
+                          offline_verifier verify, double ratio);
+
+/**
+ * Verify DIGEST SIGNATURE PUBLIC_KEY records from stdin until it
+ * closes, in the hex encodings the command line uses.  One OK, FAIL or
+ * "ERR reason" line is written per record, in order.  Output is
+ * flushed whenever the records read so far are answered, so a client
+ * may wait for each answer before sending more.
+ *
+ * @param fd The open file descriptor
+ * @param args The arguments
+ * @param offline Verify in software instead of on the device
+ *
+ * @return Success if every record verified
+ */
+int
+verify_stream (int fd, struct arguments *args, bool offline);
+
+#endif /* BATCH_H */
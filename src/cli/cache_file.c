@@ -0,0 +1,348 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "cache_file.h"
+#include <libcryptoauth.h>
+
+/**
+ * Create a directory for the owner only, or check an existing one.
+ */
+static bool
+private_dir (const char *dir)
+{
+  struct stat st;
+
+  if (0 != mkdir (dir, 0700) && EEXIST != errno)
+    return false;
+
+  return 0 == stat (dir, &st) && S_ISDIR (st.st_mode) &&
+    st.st_uid == geteuid () && 0 == (st.st_mode & 022);
+}
+
+/**
+ * The path of name in the eclet directory under the base directory
+ * named by env, or under fallback in the home directory.  Both the
+ * fallback and the eclet directory are created if missing.
+ */
+static char *
+private_path (const char *env, const char *fallback, const char *name)
+{
+  const char *base = getenv (env);
+  const char *home = getenv ("HOME");
+  char dir[4096];
+  char *path = NULL;
+  size_t len = 0;
+
+  if (NULL != base && '\0' != *base)
+    snprintf (dir, sizeof (dir), "%s", base);
+  else if (NULL != home && '\0' != *home)
+    {
+      snprintf (dir, sizeof (dir), "%s/%s", home, fallback);
+      if (0 != mkdir (dir, 0700) && EEXIST != errno)
+        return NULL;
+    }
+  else
+    return NULL;
+
+  len = strlen (dir) + strlen (CACHE_DIR_NAME) + strlen (name) + 3;
+  if ((path = malloc (len)) == NULL)
+    return NULL;
+
+  snprintf (path, len, "%s/%s", dir, CACHE_DIR_NAME);
+
+  if (!private_dir (path))
+    {
+      LCA_LOG (DEBUG, "Directory %s is not private", path);
+      free (path);
+      return NULL;
+    }
+
+  snprintf (path, len, "%s/%s/%s", dir, CACHE_DIR_NAME, name);
+
+  return path;
+}
+
+char *
+cache_file_path (const char *name)
+{
+  assert (NULL != name);
+
+  return private_path ("XDG_CACHE_HOME", ".cache", name);
+}
+
+void *
+cache_file_map (const char *name, const char *magic, size_t size)
+{
+  char *path = NULL;
+  void *map = MAP_FAILED;
+  struct cache_header *h = NULL;
+  struct stat st;
+  int fd = -1;
+
+  assert (NULL != name);
+  assert (NULL != magic);
+  assert (strlen (magic) <= CACHE_MAGIC_LEN);
+  assert (size > sizeof (struct cache_header));
+
+  if ((path = cache_file_path (name)) == NULL)
+    return NULL;
+
+  fd = open (path, O_RDWR | O_CREAT | O_CLOEXEC | O_NOFOLLOW, 0600);
+
+  if (fd < 0)
+    LCA_LOG (DEBUG, "Failed to open cache %s", path);
+  else if (0 != fstat (fd, &st) || !S_ISREG (st.st_mode) ||
+           st.st_uid != geteuid () || 0 != (st.st_mode & 077))
+    fprintf (stderr, "%s: %s\n", path, "Cache not private, ignored");
+  else if (0 == flock (fd, LOCK_EX))
+    {
+      /* Locked only while the header is checked, entries protect
+         themselves */
+      if ((size_t)st.st_size != size && 0 != ftruncate (fd, size))
+        LCA_LOG (DEBUG, "Failed to size cache %s", path);
+      else if ((map = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                            fd, 0)) != MAP_FAILED)
+        {
+          h = map;
+
+          if (0 != strncmp (h->magic, magic, CACHE_MAGIC_LEN) ||
+              h->size != size)
+            {
+              LCA_LOG (DEBUG, "Starting cache %s over", path);
+              memset (map, 0, size);
+              memcpy (h->magic, magic, strlen (magic));
+              h->size = size;
+            }
+        }
+
+      flock (fd, LOCK_UN);
+    }
+
+  if (fd >= 0)
+    close (fd);
+
+  free (path);
+
+  return MAP_FAILED != map ? map : NULL;
+}
+
+void
+cache_file_unmap (void *map, size_t size)
+{
+  if (NULL != map)
+    munmap (map, size);
+}
+
+/**
+ * Whether a text cache line is the one for key.
+ */
+static bool
+is_key_line (const char *line, const char *key)
+{
+  size_t len = strlen (key);
+
+  return 0 == strncmp (line, key, len) && ' ' == line[len];
+}
+
+char *
+cache_file_lookup (const char *name, const char *key)
+{
+  char *path = NULL;
+  char *line = NULL;
+  char *value = NULL;
+  size_t n = 0;
+  ssize_t len = 0;
+  FILE *f = NULL;
+
+  assert (NULL != key);
+
+  if ((path = cache_file_path (name)) == NULL)
+    return NULL;
+
+  if ((f = fopen (path, "r")) != NULL)
+    {
+      while (NULL == value && (len = getline (&line, &n, f)) >= 0)
+        if (is_key_line (line, key))
+          {
+            if (len > 0 && '\n' == line[len - 1])
+              line[len - 1] = '\0';
+
+            value = strdup (line + strlen (key) + 1);
+          }
+
+      free (line);
+      fclose (f);
+    }
+
+  free (path);
+
+  return value;
+}
+
+bool
+cache_file_replace (const char *name, const char *key, const char *value)
+{
+  char *path = NULL;
+  char *tmp = NULL;
+  char *line = NULL;
+  size_t n = 0;
+  FILE *in = NULL;
+  FILE *out = NULL;
+  bool ok = false;
+  int lock = -1;
+
+  assert (NULL != key);
+
+  if ((path = cache_file_path (name)) == NULL)
+    return false;
+
+  if ((tmp = malloc (strlen (path) + 24)) != NULL)
+    {
+      /* Writers take turns from the read to the rename, or one could
+         put back a line another just removed */
+      sprintf (tmp, "%s.lock", path);
+      lock = open (tmp, O_RDWR | O_CREAT | O_CLOEXEC | O_NOFOLLOW, 0600);
+
+      if (lock < 0 || 0 != flock (lock, LOCK_EX))
+        {
+          LCA_LOG (DEBUG, "Failed to lock %s", tmp);
+          if (lock >= 0)
+            close (lock);
+          free (tmp);
+          free (path);
+          return false;
+        }
+
+      sprintf (tmp, "%s.%ld", path, (long)getpid ());
+
+      if ((out = fopen (tmp, "w")) != NULL)
+        {
+          if ((in = fopen (path, "r")) != NULL)
+            {
+              while (getline (&line, &n, in) >= 0)
+                if (!is_key_line (line, key))
+                  fputs (line, out);
+
+              free (line);
+              fclose (in);
+            }
+
+          if (NULL != value)
+            fprintf (out, "%s %s\n", key, value);
+
+          ok = 0 == fclose (out) && 0 == rename (tmp, path);
+        }
+
+      if (!ok)
+        unlink (tmp);
+
+      /* Closing drops the lock */
+      close (lock);
+      free (tmp);
+    }
+
+  free (path);
+
+  return ok;
+}
+
+/**
+ * Read exactly len bytes.
+ */
+static bool
+read_all (int fd, uint8_t *buf, size_t len)
+{
+  ssize_t n = 0;
+
+  while (len > 0)
+    {
+      if ((n = read (fd, buf, len)) <= 0)
+        {
+          if (n < 0 && EINTR == errno)
+            continue;
+          return false;
+        }
+
+      buf += n;
+      len -= n;
+    }
+
+  return true;
+}
+
+bool
+config_secret (const char *name, uint8_t *secret, size_t len)
+{
+  char *path = NULL;
+  struct stat st;
+  bool ok = false;
+  int fd = -1;
+
+  assert (NULL != name);
+  assert (NULL != secret);
+
+  if ((path = private_path ("XDG_CONFIG_HOME", ".config", name)) == NULL)
+    return false;
+
+  /* O_EXCL so two processes can't both create it */
+  if ((fd = open (path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC | O_NOFOLLOW,
+                  0600)) >= 0)
+    {
+      int rnd = open ("/dev/urandom", O_RDONLY | O_CLOEXEC);
+
+      ok = rnd >= 0 && read_all (rnd, secret, len) &&
+        write (fd, secret, len) == (ssize_t)len && 0 == fsync (fd);
+
+      if (rnd >= 0)
+        close (rnd);
+      close (fd);
+
+      if (!ok)
+        unlink (path);
+    }
+  else if (EEXIST != errno ||
+           (fd = open (path, O_RDONLY | O_CLOEXEC | O_NOFOLLOW)) < 0)
+    LCA_LOG (DEBUG, "Failed to open %s", path);
+  else
+    {
+      if (0 != fstat (fd, &st) || !S_ISREG (st.st_mode) ||
+          st.st_uid != geteuid () || 0 != (st.st_mode & 077))
+        fprintf (stderr, "%s: %s\n", path, "Secret not private, ignored");
+      else
+        ok = (size_t)st.st_size == len && read_all (fd, secret, len);
+
+      close (fd);
+    }
+
+  free (path);
+
+  return ok;
+}
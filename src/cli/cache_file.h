@@ -0,0 +1,112 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef CACHE_FILE_H
+#define CACHE_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Caches live in $XDG_CACHE_HOME/eclet, or ~/.cache/eclet, and
+   secrets in $XDG_CONFIG_HOME/eclet, or ~/.config/eclet */
+#define CACHE_DIR_NAME "eclet"
+
+#define CACHE_MAGIC_LEN 16
+
+/* Every cache file starts with this header */
+struct cache_header
+{
+  char magic[CACHE_MAGIC_LEN];  /**< Names the format and version */
+  uint64_t size;                /**< The whole file, header included */
+  uint8_t reserved[40];
+};
+
+/**
+ * The path of a file in the cache directory, which is created if
+ * missing and must be private to the user.
+ *
+ * @param name The file name
+ *
+ * @return The malloc'd path, or NULL if there is no usable cache
+ * directory
+ */
+char * cache_file_path (const char *name);
+
+/**
+ * Map a cache file shared, creating it or starting it over when its
+ * header does not match.  The cache directory and file are only
+ * accessible to their owner, and a file anyone else could have
+ * written is refused, since its contents are trusted.
+ *
+ * @param name The file name in the cache directory
+ * @param magic The format name, at most CACHE_MAGIC_LEN bytes
+ * @param size The size of the file, header included
+ *
+ * @return The mapping, starting with the header, or NULL if the cache
+ * can't be used.  Unmap with cache_file_unmap.
+ */
+void * cache_file_map (const char *name, const char *magic, size_t size);
+
+void cache_file_unmap (void *map, size_t size);
+
+/**
+ * Find a line of a text cache file, where each line is a key, a space
+ * and a value.
+ *
+ * @param name The file name in the cache directory
+ * @param key The key, which must not contain a newline
+ *
+ * @return The malloc'd value without its newline, or NULL if there is
+ * no such line
+ */
+char * cache_file_lookup (const char *name, const char *key);
+
+/**
+ * Replace the line for a key in a text cache file.  The file is
+ * written aside and renamed, so concurrent readers see the old file
+ * or the new one, and writers hold a lock on NAME.lock from reading
+ * the file to the rename, so none undoes another's change.
+ *
+ * @param name The file name in the cache directory
+ * @param key The key
+ * @param value The new value, or NULL to remove the line
+ *
+ * @return false if the file couldn't be written
+ */
+bool cache_file_replace (const char *name, const char *key,
+                         const char *value);
+
+/**
+ * Read a random secret from the config directory, creating it on
+ * first use.  It is kept apart from the caches so that a cache
+ * directory copied between machines, as CI systems do, carries no
+ * key to its own contents.
+ *
+ * @param name The file name in the config directory
+ * @param secret Filled with the secret
+ * @param len The length of the secret
+ *
+ * @return false if the secret can't be read or created, or anyone
+ * but the owner could read it
+ */
+bool config_secret (const char *name, uint8_t *secret, size_t len);
+
+#endif /* CACHE_FILE_H */
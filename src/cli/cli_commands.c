@@ -24,11 +24,24 @@
 
 #include "cli_commands.h"
 #include "config.h"
+#include "auto_engine.h"
+#include "batch.h"
+#include "digest_cache.h"
+#include "file_digest.h"
+#include "incremental.h"
+#include "keyring.h"
+#include "manifest.h"
+#include "pub_key_cache.h"
+#include "verify_cache.h"
+#include "../driver/device_verify.h"
 #include "../driver/personalize.h"
+#include "../driver/profile.h"
+#include "../crypto/p256.h"
 #include <libcryptoauth.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <unistd.h>
 
 static struct command commands[NUM_CLI_COMMANDS];
 
@@ -47,9 +60,26 @@ set_defaults (struct arguments *args)
 
   args->signature = NULL;
   args->write_data = NULL;
+  args->batch = NULL;
+  args->jobs = 0;
+  args->proof = NULL;
+  args->digest = NULL;
+  args->digest_list = NULL;
+  args->engine = NULL;
+  args->stats = false;
+  args->incremental = false;
+  args->digest_cache = false;
+  args->keyring = false;
+  args->verify_cache = false;
+  args->stream = false;
+  args->stored_key = false;
+  args->pub_key_cache = false;
+  args->profile = NULL;
+  args->manifest = NULL;
 
   args->address = 0x60;
   args->bus = "/dev/i2c-1";
+  args->socket = NULL;
 
 
 }
@@ -110,14 +140,24 @@ init_cli (struct arguments *args)
   static const struct command state_cmd = {"state", cli_get_state };
   static const struct command config_cmd = {"get-config", cli_get_config_zone };
   static const struct command otp_cmd = {"get-otp", cli_get_otp_zone };
+  static const struct command inventory_cmd = {"inventory", cli_inventory };
   static const struct command personalize_cmd = {"personalize",
                                                  cli_personalize };
+  static const struct command compile_profile_cmd =
+    {CMD_COMPILE_PROFILE, cli_compile_profile };
   static const struct command gen_key = {"gen-key", cli_gen_key };
   static const struct command ecc_sign_cmd = {"sign", cli_ecc_sign };
-  static const struct command ecc_verify_cmd = {"verify", cli_ecc_verify };
+  static const struct command ecc_verify_cmd = {CMD_VERIFY, cli_ecc_verify };
   static const struct command ecc_get_pub_cmd = {"get-pub", cli_get_pub_key };
+  static const struct command load_pub_cmd = {"load-pub", cli_load_pub_key };
   static const struct command offline_ecc_verify_cmd =
     {CMD_OFFLINE_VERIFY_SIGN, cli_ecc_offline_verify };
+  static const struct command daemon_cmd = {"daemon", cli_daemon };
+  static const struct command sign_merkle_cmd = {"sign-merkle",
+                                                 cli_sign_merkle };
+  static const struct command offline_verify_merkle_cmd =
+    {CMD_OFFLINE_VERIFY_MERKLE, cli_offline_verify_merkle };
+  static const struct command hash_cmd = {CMD_HASH, cli_hash };
   int x = 0;
 
   x = add_command (random_cmd, x);
@@ -125,12 +165,19 @@ init_cli (struct arguments *args)
   x = add_command (state_cmd, x);
   x = add_command (config_cmd, x);
   x = add_command (otp_cmd, x);
+  x = add_command (inventory_cmd, x);
   x = add_command (personalize_cmd, x);
+  x = add_command (compile_profile_cmd, x);
   x = add_command (gen_key, x);
   x = add_command (ecc_sign_cmd, x);
   x = add_command (ecc_verify_cmd, x);
   x = add_command (ecc_get_pub_cmd, x);
+  x = add_command (load_pub_cmd, x);
   x = add_command (offline_ecc_verify_cmd, x);
+  x = add_command (daemon_cmd, x);
+  x = add_command (sign_merkle_cmd, x);
+  x = add_command (offline_verify_merkle_cmd, x);
+  x = add_command (hash_cmd, x);
 
   set_defaults (args);
 
@@ -146,7 +193,7 @@ cmp_commands (const char *input, const char *cmd)
 }
 
 bool
-offline_cmd (const char *command)
+offline_cmd (const char *command, const struct arguments *args)
 {
   bool is_offline = false;
 
@@ -155,13 +202,61 @@ offline_cmd (const char *command)
   else if (cmp_commands (command, CMD_OFFLINE_VERIFY))
     is_offline = true;
   else if (cmp_commands (command, CMD_HASH))
-    is_offline = true;
+    is_offline = !hash_on_device (args);
   else if (cmp_commands (command, CMD_OFFLINE_VERIFY_SIGN))
     is_offline = true;
+  else if (cmp_commands (command, CMD_OFFLINE_VERIFY_MERKLE))
+    is_offline = true;
+  else if (cmp_commands (command, CMD_COMPILE_PROFILE))
+    is_offline = true;
+  else if (cmp_commands (command, CMD_VERIFY))
+    is_offline = verify_on_host (args);
 
   return is_offline;
 }
 
+/**
+ * Whether the single signature the verify command was given is in the
+ * verification cache.  The digest is resolved here, and kept in args
+ * for the command, so stdin is only read once.
+ */
+static bool
+verified_before (struct arguments *args)
+{
+  static char digest_hex[2 * 32 + 1];
+  struct lca_octet_buffer digest = {0,0};
+  struct lca_octet_buffer signature = {0,0};
+  struct lca_octet_buffer pub_key = {0,0};
+  bool hit = false;
+  unsigned int x = 0;
+
+  /* A list or a stream reads its own records, stdin included */
+  if (!verify_cache_enabled () || NULL != args->digest_list ||
+      args->stream || NULL == args->signature ||
+      !is_hex_arg (args->signature, 128) || NULL == args->pub_key ||
+      !is_hex_arg (args->pub_key, 130))
+    return false;
+
+  if ((digest = input_digest (args)).ptr == NULL)
+    return false;
+
+  for (x = 0; x < digest.len && x < 32; x++)
+    snprintf (digest_hex + 2 * x, 3, "%02X", digest.ptr[x]);
+  args->digest = digest_hex;
+
+  signature = lca_ascii_hex_2_bin (args->signature, 128);
+  pub_key = lca_ascii_hex_2_bin (args->pub_key, 130);
+
+  hit = 32 == digest.len &&
+    verify_cache_lookup (pub_key.ptr, digest.ptr, signature.ptr);
+
+  lca_free_octet_buffer (pub_key);
+  lca_free_octet_buffer (signature);
+  lca_free_octet_buffer (digest);
+
+  return hit;
+}
+
 int
 dispatch (const char *command, struct arguments *args)
 {
@@ -179,7 +274,26 @@ dispatch (const char *command, struct arguments *args)
 
       int fd = 0;
 
-      if (offline_cmd (command))
+      if (args->digest_cache && !digest_cache_open ())
+        fprintf (stderr, "%s\n", "Digest cache unavailable, hashing all input");
+
+      if (args->keyring && !keyring_open ())
+        fprintf (stderr, "%s\n", "Keyring unavailable, verifying without it");
+
+      if (args->verify_cache && !verify_cache_open ())
+        fprintf (stderr, "%s\n",
+                 "Verification cache unavailable, verifying everything");
+
+      if (args->pub_key_cache && !pub_key_cache_open ())
+        fprintf (stderr, "%s\n",
+                 "Public key cache unavailable, asking the device");
+
+      if (cmp_commands (command, CMD_VERIFY) && verified_before (args))
+        {
+          /* Answered without waking the device */
+          result = HASHLET_COMMAND_SUCCESS;
+        }
+      else if (offline_cmd (command, args))
         {
           result = (*cmd->func)(fd, args);
         }
@@ -191,7 +305,10 @@ dispatch (const char *command, struct arguments *args)
           lca_atmel_teardown (fd);
         }
 
-
+      digest_cache_close ();
+      keyring_close ();
+      verify_cache_close ();
+      pub_key_cache_close ();
     }
 
   return result;
@@ -374,9 +491,15 @@ int
 cli_personalize (int fd, struct arguments *args)
 {
   int result = HASHLET_COMMAND_FAIL;
+  struct config_layout layout;
   assert (NULL != args);
 
-  if (STATE_PERSONALIZED != personalize (fd, STATE_PERSONALIZED, NULL))
+  if (NULL != args->profile && !profile_load (args->profile, &layout))
+    return result;
+
+  if (STATE_PERSONALIZED !=
+      personalize (fd, STATE_PERSONALIZED, NULL,
+                   NULL != args->profile ? &layout : NULL))
     printf ("Failure\n");
   else
     result = HASHLET_COMMAND_SUCCESS;
@@ -385,6 +508,38 @@ cli_personalize (int fd, struct arguments *args)
 
 }
 
+int
+cli_compile_profile (int fd, struct arguments *args)
+{
+  int result = HASHLET_COMMAND_FAIL;
+  struct config_layout layout;
+  FILE *f = NULL;
+  bool compiled = false;
+  assert (NULL != args);
+
+  if (NULL == args->profile)
+    {
+      fprintf (stderr, "%s\n", "Name the image to write with --profile");
+      return result;
+    }
+
+  if ((f = get_input_file (args)) == NULL)
+    {
+      perror (args->input_file);
+      return result;
+    }
+
+  compiled = profile_compile (f, NULL != args->input_file ?
+                              args->input_file : "stdin", &layout);
+  close_input_file (args, f);
+
+  if (compiled && profile_save (args->profile, &layout))
+    result = HASHLET_COMMAND_SUCCESS;
+
+  return result;
+
+}
+
 
 
 int
@@ -416,6 +571,9 @@ cli_gen_key (int fd, struct arguments *args)
   int result = HASHLET_COMMAND_FAIL;
   assert (NULL != args);
 
+  /* The slot's key is about to change */
+  pub_key_cache_forget (fd, args->key_slot);
+
   struct lca_octet_buffer pub_key = lca_gen_ecc_key (fd,
                                                        args->key_slot,
                                                        true);
@@ -433,6 +591,8 @@ cli_gen_key (int fd, struct arguments *args)
       assert (NULL != uncompressed.ptr);
       assert (65 == uncompressed.len);
 
+      pub_key_cache_store (fd, args->key_slot, uncompressed);
+
       output_hex (stdout, uncompressed);
       lca_free_octet_buffer (uncompressed);
       result = HASHLET_COMMAND_SUCCESS;
@@ -447,78 +607,347 @@ cli_gen_key (int fd, struct arguments *args)
 }
 
 
+struct lca_octet_buffer
+sign_digest (int fd, unsigned int slot, struct lca_octet_buffer digest)
+{
+  struct lca_octet_buffer rsp = {0,0};
+
+  assert (NULL != digest.ptr);
+
+  /* Loading the nonce is the mechanism to load the SHA256 hash into
+     the device */
+  if (load_nonce (fd, digest))
+    rsp = lca_ecc_sign (fd, slot);
+
+  return rsp;
+}
+
+bool
+verify_digest (int fd, struct lca_octet_buffer pub_key,
+               struct lca_octet_buffer signature,
+               struct lca_octet_buffer digest)
+{
+  bool result = false;
+  bool cacheable = 64 == signature.len && 32 == digest.len;
+
+  assert (NULL != pub_key.ptr);
+  assert (65 == pub_key.len);
+
+  if (cacheable &&
+      verify_cache_lookup (pub_key.ptr, digest.ptr, signature.ptr))
+    return true;
+
+  if (load_nonce (fd, digest))
+    {
+      /* The ECC108 doesn't use the leading uncompressed point format
+         tag */
+      struct lca_octet_buffer xy = { pub_key.ptr + 1, pub_key.len - 1 };
+
+      result = lca_ecc_verify (fd, xy, signature);
+    }
+
+  if (result && cacheable)
+    verify_cache_store (pub_key.ptr, digest.ptr, signature.ptr);
+
+  return result;
+}
+
+struct lca_octet_buffer
+get_pub_key (int fd, unsigned int slot)
+{
+  struct lca_octet_buffer uncompressed = pub_key_cache_lookup (fd, slot);
+  struct lca_octet_buffer pub_key = {0,0};
+
+  if (NULL != uncompressed.ptr)
+    return uncompressed;
+
+  if ((pub_key = lca_gen_ecc_key (fd, slot, false)).ptr != NULL)
+    {
+      uncompressed = lca_add_uncompressed_point_tag (pub_key);
+
+      assert (NULL != uncompressed.ptr);
+      assert (65 == uncompressed.len);
+
+      pub_key_cache_store (fd, slot, uncompressed);
+    }
+
+  return uncompressed;
+}
+
+struct lca_octet_buffer
+input_digest (struct arguments *args)
+{
+  struct lca_octet_buffer digest = {0,0};
+
+  assert (NULL != args);
+
+  if (NULL != args->digest)
+    {
+      /* The caller already hashed the data */
+      digest = lca_ascii_hex_2_bin (args->digest, 64);
+    }
+  else if (NULL != args->input_file)
+    {
+      digest = digest_path (args->input_file);
+    }
+  else
+    {
+      digest = digest_fd (STDIN_FILENO);
+    }
+
+  lca_print_hex_string ("SHA256 file digest", digest.ptr, digest.len);
+
+  return digest;
+}
+
+static bool
+p256_verify_buffers (struct lca_octet_buffer pub_key,
+                     struct lca_octet_buffer signature,
+                     struct lca_octet_buffer digest)
+{
+  const struct p256_table *g = NULL;
+  const struct p256_table *q = NULL;
+
+  if (P256_PUB_KEY_LEN != pub_key.len || P256_SIGNATURE_LEN != signature.len ||
+      P256_DIGEST_LEN != digest.len)
+    return false;
+
+  if (keyring_enabled () &&
+      (g = keyring_table (p256_base_point)) != NULL &&
+      (q = keyring_table (pub_key.ptr)) != NULL)
+    return p256_verify_precomputed (g, q, signature.ptr, digest.ptr);
+
+  return p256_verify (pub_key.ptr, signature.ptr, digest.ptr);
+}
+
+/**
+ * Check the verification cache before the verifier and remember what
+ * it accepts.
+ */
+static bool
+cached_verify (offline_verifier verify, struct lca_octet_buffer pub_key,
+               struct lca_octet_buffer signature,
+               struct lca_octet_buffer digest)
+{
+  bool cacheable = 65 == pub_key.len && 64 == signature.len &&
+    32 == digest.len;
+
+  if (cacheable &&
+      verify_cache_lookup (pub_key.ptr, digest.ptr, signature.ptr))
+    return true;
+
+  if (!verify (pub_key, signature, digest))
+    return false;
+
+  if (cacheable)
+    verify_cache_store (pub_key.ptr, digest.ptr, signature.ptr);
+
+  return true;
+}
+
+static bool
+cached_host_verify (struct lca_octet_buffer pub_key,
+                    struct lca_octet_buffer signature,
+                    struct lca_octet_buffer digest)
+{
+  return cached_verify (lca_ecdsa_p256_verify, pub_key, signature, digest);
+}
+
+static bool
+cached_p256_verify (struct lca_octet_buffer pub_key,
+                    struct lca_octet_buffer signature,
+                    struct lca_octet_buffer digest)
+{
+  return cached_verify (p256_verify_buffers, pub_key, signature, digest);
+}
+
+offline_verifier
+offline_engine (const struct arguments *args)
+{
+  bool p256 = false;
+
+  assert (NULL != args);
+
+  /* The keyring holds p256 tables, so it selects that engine */
+  if (NULL == args->engine)
+    p256 = args->keyring;
+  else if (0 == strcmp (args->engine, ENGINE_P256) ||
+           0 == strcmp (args->engine, ENGINE_AUTO))
+    p256 = true;
+  else if (0 != strcmp (args->engine, ENGINE_HOST))
+    {
+      fprintf (stderr, "%s\n", "The verify engine must be host or p256");
+      return NULL;
+    }
+
+  if (args->keyring && !p256)
+    {
+      fprintf (stderr, "%s\n", "The keyring needs the p256 engine");
+      return NULL;
+    }
+
+  if (verify_cache_enabled ())
+    return p256 ? cached_p256_verify : cached_host_verify;
+
+  return p256 ? p256_verify_buffers : lca_ecdsa_p256_verify;
+}
+
 int
 cli_ecc_sign (int fd, struct arguments *args)
 {
   int result = HASHLET_COMMAND_FAIL;
   assert (NULL != args);
 
-  FILE *f = NULL;
+  if (NULL != args->batch)
+    return sign_batch (fd, args);
 
-  if ((f = get_input_file (args)) != NULL)
+  if (NULL != args->digest_list)
+    return sign_digest_list (fd, args);
+
+  struct midstate next;
+  struct lca_octet_buffer file_digest = {0,0};
+
+  if (!args->incremental)
+    file_digest = input_digest (args);
+  else if (NULL == args->input_file)
+    fprintf (stderr, "%s\n", "Incremental signing needs a file (-f)");
+  else
+    file_digest = incremental_digest (args->input_file, &next);
+
+  if (NULL != file_digest.ptr)
     {
-      /* Digest the file then proceed */
-      struct lca_octet_buffer file_digest = {0,0};
-      file_digest = lca_sha256 (f);
-      close_input_file (args, f);
 
-      lca_print_hex_string ("SHA256 file digest",
-                             file_digest.ptr,
-                             file_digest.len);
+      /* Forces a seed update on the RNG */
+      struct lca_octet_buffer r = lca_get_random (fd, true);
 
-      if (NULL != file_digest.ptr)
+      struct lca_octet_buffer rsp = sign_digest (fd, args->key_slot,
+                                                 file_digest);
+
+      if (NULL != rsp.ptr)
+        {
+          output_hex (stdout, rsp);
+          lca_free_octet_buffer (rsp);
+          result = HASHLET_COMMAND_SUCCESS;
+
+          /* Only move the saved state forward once it was signed */
+          if (args->incremental && !save_midstate (args->input_file, &next))
+            result = HASHLET_COMMAND_FAIL;
+        }
+      else
         {
+          fprintf (stderr, "%s\n", "Sign Command failed.");
+        }
 
-          /* Forces a seed update on the RNG */
-          struct lca_octet_buffer r = lca_get_random (fd, true);
+      lca_free_octet_buffer (r);
+      lca_free_octet_buffer (file_digest);
+    }
 
-          /* Loading the nonce is the mechanism to load the SHA256
-             hash into the device */
-          if (load_nonce (fd, file_digest))
-            {
+  return result;
+}
 
-              struct lca_octet_buffer rsp = lca_ecc_sign (fd, args->key_slot);
 
-              if (NULL != rsp.ptr)
-                {
-                  output_hex (stdout, rsp);
-                  lca_free_octet_buffer (rsp);
-                  result = HASHLET_COMMAND_SUCCESS;
-                }
-              else
-                {
-                  fprintf (stderr, "%s\n", "Sign Command failed.");
-                }
+/**
+ * verify --stored-key: the key was written to the key slot by
+ * load-pub, so only the signature goes to the device.
+ */
+static int
+verify_stored (int fd, struct arguments *args)
+{
+  int result = HASHLET_COMMAND_FAIL;
+  struct lca_octet_buffer signature = {0,0};
+  struct lca_octet_buffer file_digest = {0,0};
+  struct device_verify_packet packet;
 
-            }
+  signature = lca_ascii_hex_2_bin (args->signature, 128);
 
-          lca_free_octet_buffer (r);
-        }
-    }
-  else
+  if ((file_digest = input_digest (args)).ptr != NULL)
     {
-      LCA_LOG (DEBUG, "File pointer is NULL");
+      device_verify_prepare_stored (&packet, args->key_slot, signature.ptr,
+                                    file_digest.ptr);
+
+      if (device_verify_send (fd, &packet))
+        result = HASHLET_COMMAND_SUCCESS;
+      else
+        fprintf (stderr, "%s\n", "Verify Command failed.");
+
+      lca_free_octet_buffer (file_digest);
     }
 
+  lca_free_octet_buffer (signature);
 
   return result;
 }
 
-
 int
 cli_ecc_verify (int fd, struct arguments *args)
 {
   int result = HASHLET_COMMAND_FAIL;
   assert (NULL != args);
 
-  FILE *f = NULL;
   struct lca_octet_buffer signature = {0,0};
   struct lca_octet_buffer pub_key = {0,0};
+  struct engine_rates rates;
+  offline_verifier verify = NULL;
+  bool host = false;
+
+  if (NULL != args->engine && 0 != strcmp (args->engine, ENGINE_DEVICE) &&
+      0 != strcmp (args->engine, ENGINE_AUTO))
+    {
+      fprintf (stderr, "%s\n", "The verify engine must be device or auto");
+      return result;
+    }
 
-  if (NULL == args->signature)
+  if (args->stored_key && (NULL != args->engine || args->stream))
+    {
+      fprintf (stderr, "%s\n", "--stored-key only verifies on the device, "
+               "and not with --stream");
+      return result;
+    }
+
+  if (NULL != args->engine && 0 == strcmp (args->engine, ENGINE_AUTO))
+    {
+      if ((verify = offline_engine (args)) == NULL)
+        return result;
+
+      /* Measured once per host and device, verify_on_host has
+         already loaded them when the device is not open */
+      if (!engine_rates_load (args, &rates))
+        engine_rates_measure (fd, args, &rates);
+
+      host = rates.host >= rates.device;
+
+      if (NULL != args->digest_list && NULL != args->pub_key &&
+          rates.device > 0 && rates.host > 0)
+        {
+          double ratio = host ? rates.host / rates.device :
+            rates.device / rates.host;
+
+          if (ratio <= AUTO_SPLIT_MAX_RATIO)
+            return verify_digest_list_split (fd, args, verify, ratio);
+        }
+    }
+
+  if (args->stream)
+    {
+      return verify_stream (fd, args, host);
+    }
+  else if (NULL != args->digest_list &&
+           (NULL != args->pub_key || args->stored_key))
+    {
+      return verify_digest_list (fd, args, host);
+    }
+  else if (host)
+    {
+      return cli_ecc_offline_verify (fd, args);
+    }
+  else if (NULL == args->signature)
     {
       perror ("Signature required");
     }
+  else if (args->stored_key)
+    {
+      return verify_stored (fd, args);
+    }
   else if (NULL == args->pub_key)
     {
       perror ("Public Key required");
@@ -531,52 +960,21 @@ cli_ecc_verify (int fd, struct arguments *args)
       pub_key = lca_ascii_hex_2_bin (args->pub_key, 130);
       lca_print_hex_string ("Public Key", pub_key.ptr, pub_key.len);
 
-      if ((f = get_input_file (args)) != NULL)
-        {
-          /* Digest the file then proceed */
-          struct lca_octet_buffer file_digest = {0,0};
-          file_digest = lca_sha256 (f);
-          close_input_file (args, f);
+      struct lca_octet_buffer file_digest = input_digest (args);
 
-          lca_print_hex_string ("SHA256 file digest",
-                                 file_digest.ptr,
-                                 file_digest.len);
+      if (NULL != file_digest.ptr)
+        {
 
-          if (NULL != file_digest.ptr)
+          if (verify_digest (fd, pub_key, signature, file_digest))
             {
-
-              /* Loading the nonce is the mechanism to load the SHA256
-                 hash into the device */
-              if (load_nonce (fd, file_digest))
-                {
-
-                  /* The ECC108 doesn't use the leading uncompressed
-                     point format tag */
-                  pub_key.ptr = pub_key.ptr + 1;
-                  pub_key.len = pub_key.len - 1;
-                  if (lca_ecc_verify (fd, pub_key, signature))
-                    {
-                      result = HASHLET_COMMAND_SUCCESS;
-
-                    }
-                  else
-                    {
-                      fprintf (stderr, "%s\n", "Verify Command failed.");
-                    }
-
-                  /* restore pub key */
-                  pub_key.ptr = pub_key.ptr - 1;
-                  pub_key.len = pub_key.len + 1;
-                }
-
+              result = HASHLET_COMMAND_SUCCESS;
+            }
+          else
+            {
+              fprintf (stderr, "%s\n", "Verify Command failed.");
             }
 
           lca_free_octet_buffer (file_digest);
-
-        }
-      else
-        {
-          /* temp_key_loaded already false */
         }
 
       lca_free_octet_buffer (pub_key);
@@ -593,11 +991,27 @@ cli_ecc_offline_verify (int fd, struct arguments *args)
   int result = HASHLET_COMMAND_FAIL;
   assert (NULL != args);
 
-  FILE *f = NULL;
   struct lca_octet_buffer signature = {0,0};
   struct lca_octet_buffer pub_key = {0,0};
+  offline_verifier verify = NULL;
 
-  if (NULL == args->signature)
+  if ((verify = offline_engine (args)) == NULL)
+    {
+      return result;
+    }
+  else if (args->stream)
+    {
+      return verify_stream (fd, args, true);
+    }
+  else if (NULL != args->manifest)
+    {
+      return verify_manifest (args);
+    }
+  else if (NULL != args->digest_list && NULL != args->pub_key)
+    {
+      return verify_digest_list (fd, args, true);
+    }
+  else if (NULL == args->signature)
     {
       perror ("Signature required");
     }
@@ -613,44 +1027,30 @@ cli_ecc_offline_verify (int fd, struct arguments *args)
       pub_key = lca_ascii_hex_2_bin (args->pub_key, 130);
       lca_print_hex_string ("Public Key", pub_key.ptr, pub_key.len);
 
-      if ((f = get_input_file (args)) != NULL)
-        {
-          /* Digest the file then proceed */
-          struct lca_octet_buffer file_digest = {0,0};
-          file_digest = lca_sha256 (f);
-          close_input_file (args, f);
-
-          lca_print_hex_string ("SHA256 file digest",
-                                 file_digest.ptr,
-                                 file_digest.len);
+      struct lca_octet_buffer file_digest = input_digest (args);
 
-          if (NULL != file_digest.ptr)
+      if (NULL != file_digest.ptr)
+        {
+          if (verify (pub_key, signature, file_digest))
             {
-              if (lca_ecdsa_p256_verify (pub_key, signature, file_digest))
-                {
-                  LCA_LOG (DEBUG, "Verify Success");
-                  result = HASHLET_COMMAND_SUCCESS;
-                }
-              else
-                {
-                  perror ("Verify Failed\n");
-                  LCA_LOG (DEBUG, "Verify Failure");
-                }
-
-              lca_free_octet_buffer (file_digest);
+              LCA_LOG (DEBUG, "Verify Success");
+              result = HASHLET_COMMAND_SUCCESS;
             }
           else
             {
-              LCA_LOG (DEBUG, "Digest NULL");
+              perror ("Verify Failed\n");
+              LCA_LOG (DEBUG, "Verify Failure");
             }
 
-          lca_free_octet_buffer (pub_key);
-          lca_free_octet_buffer (signature);
+          lca_free_octet_buffer (file_digest);
         }
       else
         {
-          LCA_LOG (DEBUG, "Error loading file");
+          LCA_LOG (DEBUG, "Digest NULL");
         }
+
+      lca_free_octet_buffer (pub_key);
+      lca_free_octet_buffer (signature);
     }
 
   return result;
@@ -664,21 +1064,12 @@ cli_get_pub_key (int fd, struct arguments *args)
   int result = HASHLET_COMMAND_FAIL;
   assert (NULL != args);
 
-  struct lca_octet_buffer pub_key = lca_gen_ecc_key (fd,
-                                                       args->key_slot,
-                                                       false);
+  struct lca_octet_buffer pub_key = get_pub_key (fd, args->key_slot);
 
   if (NULL != pub_key.ptr)
     {
-
-      struct lca_octet_buffer uncompressed =
-        lca_add_uncompressed_point_tag (pub_key);
-
-      assert (NULL != uncompressed.ptr);
-      assert (65 == uncompressed.len);
-
-      output_hex (stdout, uncompressed);
-      lca_free_octet_buffer (uncompressed);
+      output_hex (stdout, pub_key);
+      lca_free_octet_buffer (pub_key);
       result = HASHLET_COMMAND_SUCCESS;
     }
   else
@@ -689,3 +1080,39 @@ cli_get_pub_key (int fd, struct arguments *args)
   return result;
 
 }
+
+int
+cli_load_pub_key (int fd, struct arguments *args)
+{
+  int result = HASHLET_COMMAND_FAIL;
+  struct lca_octet_buffer pub_key = {0,0};
+
+  assert (NULL != args);
+
+  if (NULL == args->pub_key)
+    {
+      fprintf (stderr, "%s\n", "Public Key required");
+      return result;
+    }
+
+  if (args->key_slot < PUB_KEY_MIN_SLOT)
+    {
+      fprintf (stderr, "Key slot %u is too small for a public key, "
+               "use %u or above\n", args->key_slot, PUB_KEY_MIN_SLOT);
+      return result;
+    }
+
+  pub_key = lca_ascii_hex_2_bin (args->pub_key, 130);
+
+  /* The slot holds X and Y, so only the uncompressed form fits */
+  if (0x04 != pub_key.ptr[0])
+    fprintf (stderr, "%s\n", "The public key must start with the 04 tag");
+  else if (device_verify_load_key (fd, args->key_slot, pub_key.ptr))
+    result = HASHLET_COMMAND_SUCCESS;
+  else
+    fprintf (stderr, "%s\n", "Load Pub key command failed");
+
+  lca_free_octet_buffer (pub_key);
+
+  return result;
+}
@@ -35,7 +35,16 @@
 /* Command list */
 #define CMD_OFFLINE_VERIFY "offline-verify"
 #define CMD_HASH "hash"
+#define CMD_VERIFY "verify"
 #define CMD_OFFLINE_VERIFY_SIGN "offline-verify-sign"
+#define CMD_OFFLINE_VERIFY_MERKLE "offline-verify-merkle"
+#define CMD_COMPILE_PROFILE "compile-profile"
+
+/* Where a command does its work, selected with --engine */
+#define ENGINE_HOST "host"
+#define ENGINE_DEVICE "device"
+#define ENGINE_P256 "p256"
+#define ENGINE_AUTO "auto"
 
 /* Used by main to communicate with parse_opt. */
 struct arguments
@@ -55,6 +64,23 @@ struct arguments
   const char *meta;
   const char *write_data;
   const char *bus;
+  const char *socket;
+  const char *batch;
+  unsigned int jobs;
+  const char *proof;
+  const char *digest;
+  const char *digest_list;
+  const char *engine;
+  bool stats;
+  bool incremental;
+  bool digest_cache;
+  const char *manifest;
+  bool keyring;
+  bool verify_cache;
+  bool stream;
+  bool stored_key;
+  bool pub_key_cache;
+  const char *profile;
 };
 
 struct command
@@ -98,7 +124,7 @@ int dispatch (const char *command, struct arguments *args);
  */
 void init_cli (struct arguments * args);
 
-#define NUM_CLI_COMMANDS 15
+#define NUM_CLI_COMMANDS 19
 
 /**
  * Gets random from the device
@@ -150,7 +176,21 @@ int cli_get_config_zone (int fd, struct arguments *args);
  */
 int cli_get_otp_zone (int fd, struct arguments *args);
 /**
- * Performs a straight SHA256 of data, meant for testing purposes
+ * Print the serial number, state, config zone, OTP zone and every
+ * private key slot's public key as one JSON record, using as few
+ * device commands as possible.
+ *
+ * @param fd The open file descriptor
+ * @param args The argument structure
+ *
+ * @return the exit code
+ */
+int cli_inventory (int fd, struct arguments *args);
+
+/**
+ * SHA256 of the input file, stdin or every file in the batch list,
+ * on the host or with the device's SHA engine (--engine), optionally
+ * reporting throughput (--stats).
  *
  * @param fd The open file descriptor
  * @param args The argument structure
@@ -159,18 +199,87 @@ int cli_get_otp_zone (int fd, struct arguments *args);
  */
 int cli_hash (int fd, struct arguments *args);
 
+/**
+ * Whether the hash command was asked to use the device, which is then
+ * opened for it.
+ *
+ * @param args The argument structure
+ *
+ * @return true for --engine device
+ */
+bool hash_on_device (const struct arguments *args);
+
 /**
  * Perform the device personalization by setting the config zone,
  * writing the OTP zone, and loading keys.  Keys are stored in a file
  * if successful.
  *
  * @param fd The open file descriptor
- * @param args The argument structure
+ * @param args The argument structure, --profile names a compiled
+ * profile to use instead of the default layout
  *
  * @return the exit code
  */
 int cli_personalize (int fd, struct arguments *args);
 
+/**
+ * Compile the text profile in the input file into the binary image
+ * named by --profile.  This doesn't use the device.
+ *
+ * @param fd Unused
+ * @param args The argument structure
+ *
+ * @return the exit code
+ */
+int cli_compile_profile (int fd, struct arguments *args);
+
+/**
+ * Open the input file option, or stdin when it isn't set.
+ *
+ * @param args The arguments
+ *
+ * @return The open stream, or NULL if the file can't be opened
+ */
+FILE* get_input_file (struct arguments *args);
+
+/**
+ * Close the stream from get_input_file, leaving stdin open.
+ *
+ * @param args The arguments
+ * @param f The stream
+ */
+void close_input_file (struct arguments *args, FILE *f);
+
+/**
+ * The SHA256 digest to sign or verify: the digest option when given,
+ * otherwise the digest of the input file.
+ *
+ * @param args The arguments
+ *
+ * @return The 32 byte digest, which must be freed, or a NULL buffer
+ * on failure.
+ */
+struct lca_octet_buffer input_digest (struct arguments *args);
+
+/* Checks a signature over a digest in software */
+typedef bool (*offline_verifier) (struct lca_octet_buffer pub_key,
+                                  struct lca_octet_buffer signature,
+                                  struct lca_octet_buffer digest);
+
+/**
+ * The software verifier selected with --engine: host, the default, is
+ * libcryptoauth and p256 is the dedicated P-256 code, which is several
+ * times faster.  --keyring selects p256 and uses the tables cached for
+ * each key.  auto, which lets verify pick between the device and the
+ * host, verifies with p256 on the host.  With the verification cache
+ * open, the verifier checks it first and remembers successes.
+ *
+ * @param args The arguments
+ *
+ * @return The verifier, or NULL after reporting an unknown engine
+ */
+offline_verifier offline_engine (const struct arguments *args);
+
 bool is_expected_len (const char* arg, unsigned int len);
 bool is_hex_arg (const char* arg, unsigned int len);
 
@@ -223,6 +332,18 @@ cli_ecc_verify (int fd, struct arguments *args);
 int
 cli_get_pub_key (int fd, struct arguments *args);
 
+/**
+ * Write the public key option into the key slot, so verify
+ * --stored-key can check signatures against it without sending it.
+ *
+ * @param fd The open file descriptor.
+ * @param args The arguments, the key slot must be 8 or above.
+ *
+ * @return Success or failure code
+ */
+int
+cli_load_pub_key (int fd, struct arguments *args);
+
 /**
  * Performs an ECDSA signature verification without the device.
  *
@@ -234,4 +355,85 @@ cli_get_pub_key (int fd, struct arguments *args);
 int
 cli_ecc_offline_verify (int fd, struct arguments *args);
 
+/**
+ * Sign every file in the batch list with one device signature over
+ * the root of a SHA256 Merkle tree.  A proof file is written next to
+ * each file.
+ *
+ * @param fd The open file descriptor
+ * @param args The arguments, batch names the list file
+ *
+ * @return The exit code
+ */
+int
+cli_sign_merkle (int fd, struct arguments *args);
+
+/**
+ * Verifies a file against its Merkle proof and the root signature
+ * without the device.
+ *
+ * @param fd The open file descriptor (unused)
+ * @param args The arguments, proof names the proof file
+ *
+ * @return Success if the file is in the signed tree
+ */
+int
+cli_offline_verify_merkle (int fd, struct arguments *args);
+
+/**
+ * Load a SHA256 digest into the device and sign it with the key in
+ * the given slot.
+ *
+ * @param fd The open file descriptor
+ * @param slot The private key slot
+ * @param digest The 32 byte digest to sign
+ *
+ * @return The signature (R,S), which must be freed, or a NULL buffer
+ * on failure.
+ */
+struct lca_octet_buffer
+sign_digest (int fd, unsigned int slot, struct lca_octet_buffer digest);
+
+/**
+ * Load a SHA256 digest into the device and verify the signature
+ * against it.
+ *
+ * @param fd The open file descriptor
+ * @param pub_key The 65 byte public key, including the 0x04 tag
+ * @param signature The 64 byte signature (R,S)
+ * @param digest The 32 byte digest
+ *
+ * @return True if the device verified the signature
+ */
+bool
+verify_digest (int fd, struct lca_octet_buffer pub_key,
+               struct lca_octet_buffer signature,
+               struct lca_octet_buffer digest);
+
+/**
+ * Compute the public key for the private key in the given slot.
+ *
+ * @param fd The open file descriptor
+ * @param slot The private key slot
+ *
+ * @return The 65 byte public key with the 0x04 tag, which must be
+ * freed, or a NULL buffer on failure.
+ */
+struct lca_octet_buffer
+get_pub_key (int fd, unsigned int slot);
+
+/**
+ * Hold the device open and serve sign, verify, random and get-pub
+ * requests on a local Unix socket until interrupted.
+ *
+ * @param fd The open file descriptor
+ * @param args The arguments, the socket option names the socket.
+ * Without it the socket is $XDG_RUNTIME_DIR/eclet.sock, or
+ * /tmp/eclet-UID/eclet.sock in a directory only the caller can use.
+ *
+ * @return The exit code
+ */
+int
+cli_daemon (int fd, struct arguments *args);
+
 #endif /* CLI_COMMANDS_H */
@@ -0,0 +1,434 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file   daemon.c
+ *
+ * @brief  Serves device requests over a Unix socket so the device
+ * stays open between operations.
+ *
+ * The protocol is line based ASCII, one request per line:
+ *
+ *   random
+ *   sign SLOT DIGEST
+ *   verify DIGEST SIGNATURE PUBLIC_KEY
+ *   get-pub SLOT
+ *
+ * DIGEST is 64 hex characters, SIGNATURE is 128 (R,S) and PUBLIC_KEY
+ * is 130 (0x04,X,Y), the same encodings the command line uses.  Each
+ * request is answered with one line: "OK", "OK HEX", "FAIL" or
+ * "ERR reason".
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "cli_commands.h"
+#include <libcryptoauth.h>
+
+#define DAEMON_MAX_CLIENTS 16
+#define DAEMON_LINE_MAX 512
+#define DAEMON_SOCKET_NAME "eclet.sock"
+
+struct client
+{
+  int sock;
+  size_t len;
+  char line[DAEMON_LINE_MAX];
+};
+
+static volatile sig_atomic_t daemon_stop = 0;
+
+static void
+handle_stop (int sig)
+{
+  daemon_stop = 1;
+}
+
+static void
+reply (int sock, const char *status, struct lca_octet_buffer buf)
+{
+  char out[DAEMON_LINE_MAX];
+  size_t len = 0;
+  unsigned int x = 0;
+
+  len = snprintf (out, sizeof (out), "%s", status);
+
+  if (NULL != buf.ptr)
+    {
+      out[len++] = ' ';
+      for (x = 0; x < buf.len && len + 3 < sizeof (out); x++)
+        len += snprintf (out + len, sizeof (out) - len, "%02X", buf.ptr[x]);
+    }
+
+  out[len++] = '\n';
+
+  if (send (sock, out, len, MSG_NOSIGNAL) != len)
+    LCA_LOG (DEBUG, "Short write to client");
+}
+
+static bool
+parse_slot (const char *arg, unsigned int *slot)
+{
+  char *end = NULL;
+  long s;
+
+  if (NULL == arg)
+    return false;
+
+  s = strtol (arg, &end, 10);
+  if (*end != '\0' || s < 0 || s > 15)
+    return false;
+
+  *slot = s;
+  return true;
+}
+
+static void
+serve_request (int fd, int sock, char *line)
+{
+  static const struct lca_octet_buffer none = {0,0};
+  char *save = NULL;
+  const char *op = strtok_r (line, " \t\r", &save);
+  const char *a1 = strtok_r (NULL, " \t\r", &save);
+  const char *a2 = strtok_r (NULL, " \t\r", &save);
+  const char *a3 = strtok_r (NULL, " \t\r", &save);
+  unsigned int slot = 0;
+
+  if (NULL == op)
+    reply (sock, "ERR empty request", none);
+  else if (0 == strcmp (op, "random"))
+    {
+      struct lca_octet_buffer rsp = lca_get_random (fd, false);
+
+      if (NULL != rsp.ptr)
+        {
+          reply (sock, "OK", rsp);
+          lca_free_octet_buffer (rsp);
+        }
+      else
+        reply (sock, "ERR random failed", none);
+    }
+  else if (0 == strcmp (op, "sign"))
+    {
+      if (!parse_slot (a1, &slot) || NULL == a2 || !is_hex_arg (a2, 64))
+        reply (sock, "ERR usage: sign SLOT DIGEST", none);
+      else
+        {
+          struct lca_octet_buffer digest = lca_ascii_hex_2_bin (a2, 64);
+
+          /* Forces a seed update on the RNG, as the sign command does */
+          struct lca_octet_buffer r = lca_get_random (fd, true);
+          struct lca_octet_buffer rsp = sign_digest (fd, slot, digest);
+
+          if (NULL != rsp.ptr)
+            {
+              reply (sock, "OK", rsp);
+              lca_free_octet_buffer (rsp);
+            }
+          else
+            reply (sock, "ERR sign failed", none);
+
+          lca_free_octet_buffer (r);
+          lca_free_octet_buffer (digest);
+        }
+    }
+  else if (0 == strcmp (op, "verify"))
+    {
+      if (NULL == a1 || !is_hex_arg (a1, 64) ||
+          NULL == a2 || !is_hex_arg (a2, 128) ||
+          NULL == a3 || !is_hex_arg (a3, 130))
+        reply (sock, "ERR usage: verify DIGEST SIGNATURE PUBLIC_KEY", none);
+      else
+        {
+          struct lca_octet_buffer digest = lca_ascii_hex_2_bin (a1, 64);
+          struct lca_octet_buffer signature = lca_ascii_hex_2_bin (a2, 128);
+          struct lca_octet_buffer pub_key = lca_ascii_hex_2_bin (a3, 130);
+
+          if (verify_digest (fd, pub_key, signature, digest))
+            reply (sock, "OK", none);
+          else
+            reply (sock, "FAIL", none);
+
+          lca_free_octet_buffer (pub_key);
+          lca_free_octet_buffer (signature);
+          lca_free_octet_buffer (digest);
+        }
+    }
+  else if (0 == strcmp (op, "get-pub"))
+    {
+      if (!parse_slot (a1, &slot))
+        reply (sock, "ERR usage: get-pub SLOT", none);
+      else
+        {
+          struct lca_octet_buffer pub_key = get_pub_key (fd, slot);
+
+          if (NULL != pub_key.ptr)
+            {
+              reply (sock, "OK", pub_key);
+              lca_free_octet_buffer (pub_key);
+            }
+          else
+            reply (sock, "ERR get-pub failed", none);
+        }
+    }
+  else
+    reply (sock, "ERR unknown request", none);
+}
+
+/**
+ * Read what is available from the client and serve each complete
+ * line.
+ *
+ * @return false when the client should be dropped
+ */
+static bool
+serve_client (int fd, struct client *c)
+{
+  ssize_t n = recv (c->sock, c->line + c->len,
+                    sizeof (c->line) - 1 - c->len, 0);
+  char *start = c->line;
+  char *nl = NULL;
+
+  if (n <= 0)
+    return false;
+
+  c->len += n;
+  c->line[c->len] = '\0';
+
+  while ((nl = memchr (start, '\n', c->len - (start - c->line))) != NULL)
+    {
+      *nl = '\0';
+      serve_request (fd, c->sock, start);
+      start = nl + 1;
+    }
+
+  c->len -= start - c->line;
+  memmove (c->line, start, c->len);
+
+  /* A line that fills the buffer can never be valid */
+  if (c->len == sizeof (c->line) - 1)
+    {
+      static const struct lca_octet_buffer none = {0,0};
+      reply (c->sock, "ERR request too long", none);
+      return false;
+    }
+
+  return true;
+}
+
+/**
+ * The default socket path.  $XDG_RUNTIME_DIR is private to its owner.
+ * Without it the socket goes in /tmp/eclet-UID, which is refused
+ * unless it is a directory only the caller can use, since anyone can
+ * create that name first.
+ */
+static bool
+default_socket (char *path, size_t len)
+{
+  const char *run = getenv ("XDG_RUNTIME_DIR");
+  char dir[sizeof (((struct sockaddr_un *)0)->sun_path)];
+  struct stat st;
+
+  if (NULL != run && '/' == run[0])
+    return snprintf (path, len, "%s/%s", run, DAEMON_SOCKET_NAME) < len;
+
+  snprintf (dir, sizeof (dir), "/tmp/eclet-%lu", (unsigned long)getuid ());
+
+  if (mkdir (dir, 0700) < 0 && EEXIST != errno)
+    {
+      perror (dir);
+      return false;
+    }
+
+  if (lstat (dir, &st) < 0 || !S_ISDIR (st.st_mode) ||
+      st.st_uid != getuid () || 0 != (st.st_mode & 077))
+    {
+      fprintf (stderr, "%s: %s\n", dir, "Not a private directory");
+      return false;
+    }
+
+  return snprintf (path, len, "%s/%s", dir, DAEMON_SOCKET_NAME) < len;
+}
+
+/**
+ * Remove what is at path, only if it is a socket the caller owns, so
+ * a stale socket can be replaced without deleting anything else.
+ *
+ * @return true if nothing is left at path
+ */
+static bool
+remove_socket (const char *path)
+{
+  struct stat st;
+
+  if (lstat (path, &st) < 0)
+    return ENOENT == errno;
+
+  if (!S_ISSOCK (st.st_mode) || st.st_uid != getuid ())
+    {
+      fprintf (stderr, "%s: %s\n", path, "Exists and is not our socket");
+      return false;
+    }
+
+  return 0 == unlink (path);
+}
+
+static int
+open_socket (const char *path)
+{
+  struct sockaddr_un addr;
+  int sock = -1;
+  mode_t old_mask;
+
+  if (strlen (path) >= sizeof (addr.sun_path))
+    {
+      fprintf (stderr, "%s\n", "Socket path too long");
+      return -1;
+    }
+
+  if ((sock = socket (AF_UNIX, SOCK_STREAM, 0)) < 0)
+    {
+      perror ("Failed to create socket");
+      return -1;
+    }
+
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  strcpy (addr.sun_path, path);
+
+  if (!remove_socket (path))
+    {
+      close (sock);
+      return -1;
+    }
+
+  /* Only the owner may ask the device to sign */
+  old_mask = umask (0177);
+
+  if (bind (sock, (struct sockaddr *)&addr, sizeof (addr)) < 0 ||
+      listen (sock, DAEMON_MAX_CLIENTS) < 0)
+    {
+      perror ("Failed to bind socket");
+      close (sock);
+      sock = -1;
+    }
+
+  umask (old_mask);
+
+  return sock;
+}
+
+int
+cli_daemon (int fd, struct arguments *args)
+{
+  struct pollfd fds[DAEMON_MAX_CLIENTS + 1];
+  struct client clients[DAEMON_MAX_CLIENTS];
+  struct sigaction sa;
+  char default_path[sizeof (((struct sockaddr_un *)0)->sun_path)];
+  const char *path = NULL;
+  int num_clients = 0;
+  int listener = -1;
+  int x = 0;
+
+  assert (NULL != args);
+
+  if (NULL == (path = args->socket))
+    {
+      if (!default_socket (default_path, sizeof (default_path)))
+        {
+          fprintf (stderr, "%s\n", "No default socket path, use --socket");
+          return HASHLET_COMMAND_FAIL;
+        }
+
+      path = default_path;
+    }
+
+  if ((listener = open_socket (path)) < 0)
+    return HASHLET_COMMAND_FAIL;
+
+  memset (&sa, 0, sizeof (sa));
+  sa.sa_handler = handle_stop;
+  sigaction (SIGINT, &sa, NULL);
+  sigaction (SIGTERM, &sa, NULL);
+
+  LCA_LOG (DEBUG, "Listening on %s", path);
+
+  while (!daemon_stop)
+    {
+      fds[0].fd = listener;
+      fds[0].events = num_clients < DAEMON_MAX_CLIENTS ? POLLIN : 0;
+
+      for (x = 0; x < num_clients; x++)
+        {
+          fds[x + 1].fd = clients[x].sock;
+          fds[x + 1].events = POLLIN;
+        }
+
+      if (poll (fds, num_clients + 1, -1) < 0)
+        {
+          if (EINTR != errno)
+            perror ("poll");
+          continue;
+        }
+
+      /* Walk backwards so a dropped client can be replaced by the
+         last one without skipping anything */
+      for (x = num_clients - 1; x >= 0; x--)
+        {
+          if (0 == fds[x + 1].revents)
+            continue;
+
+          if (!serve_client (fd, &clients[x]))
+            {
+              close (clients[x].sock);
+              clients[x] = clients[--num_clients];
+            }
+        }
+
+      if (fds[0].revents & POLLIN)
+        {
+          int sock = accept (listener, NULL, NULL);
+
+          if (sock >= 0)
+            {
+              clients[num_clients].sock = sock;
+              clients[num_clients].len = 0;
+              num_clients++;
+            }
+        }
+    }
+
+  for (x = 0; x < num_clients; x++)
+    close (clients[x].sock);
+
+  close (listener);
+  remove_socket (path);
+
+  return HASHLET_COMMAND_SUCCESS;
+}
@@ -0,0 +1,236 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file   digest_cache.c
+ *
+ * @brief  A persistent, memory mapped cache of file digests.
+ *
+ * The table is open addressed with a short probe from a slot chosen
+ * by device and inode.  Several processes and threads may use it at
+ * once without locks: each entry carries an HMAC of its contents, so
+ * an entry torn by a concurrent writer, or written without the key,
+ * reads as a miss.
+ *
+ * An entry is only used when the size and the nanosecond mtime and
+ * ctime all still match.  ctime can't be set from user space, so
+ * restoring an old mtime does not revive a stale entry.
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+#include "cache_file.h"
+#include "digest_cache.h"
+#include "../crypto/sha256.h"
+
+struct digest_cache_entry
+{
+  uint64_t dev;
+  uint64_t ino;
+  uint64_t size;
+  int64_t mtime_ns;
+  int64_t ctime_ns;
+  uint8_t digest[SHA256_DIGEST_LEN];
+  uint8_t check[16];            /**< HMAC of the above, truncated */
+};
+
+struct digest_cache
+{
+  struct cache_header header;
+  struct digest_cache_entry entries[DIGEST_CACHE_ENTRIES];
+};
+
+static struct digest_cache *cache = NULL;
+static uint8_t cache_key[DIGEST_CACHE_KEY_LEN];
+
+bool
+digest_cache_open (void)
+{
+  if (NULL != cache)
+    return true;
+
+  if (!config_secret (DIGEST_CACHE_KEY_FILE, cache_key, sizeof (cache_key)))
+    return false;
+
+  cache = cache_file_map (DIGEST_CACHE_FILE, DIGEST_CACHE_MAGIC,
+                          sizeof (struct digest_cache));
+
+  return NULL != cache;
+}
+
+void
+digest_cache_close (void)
+{
+  cache_file_unmap (cache, sizeof (struct digest_cache));
+  cache = NULL;
+  memset (cache_key, 0, sizeof (cache_key));
+}
+
+bool
+digest_cache_enabled (void)
+{
+  return NULL != cache;
+}
+
+static int64_t
+ns (const struct timespec *t)
+{
+  return (int64_t)t->tv_sec * 1000000000LL + t->tv_nsec;
+}
+
+static void
+make_key (const struct stat *st, struct digest_cache_entry *e)
+{
+  memset (e, 0, sizeof (*e));
+  e->dev = st->st_dev;
+  e->ino = st->st_ino;
+  e->size = st->st_size;
+  e->mtime_ns = ns (&st->st_mtim);
+  e->ctime_ns = ns (&st->st_ctim);
+}
+
+static void
+entry_check (const struct digest_cache_entry *e, uint8_t *check)
+{
+  uint8_t digest[SHA256_DIGEST_LEN];
+
+  hmac_sha256 (cache_key, sizeof (cache_key), e,
+               offsetof (struct digest_cache_entry, check), digest);
+  memcpy (check, digest, sizeof (e->check));
+}
+
+static unsigned int
+home_slot (const struct stat *st)
+{
+  uint64_t h = (uint64_t)st->st_ino ^ ((uint64_t)st->st_dev << 32);
+
+  /* splitmix64 finalizer */
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebULL;
+  h ^= h >> 31;
+
+  return h & (DIGEST_CACHE_ENTRIES - 1);
+}
+
+bool
+digest_cache_same (const struct stat *a, const struct stat *b)
+{
+  assert (NULL != a);
+  assert (NULL != b);
+
+  return a->st_dev == b->st_dev && a->st_ino == b->st_ino &&
+    a->st_size == b->st_size &&
+    ns (&a->st_mtim) == ns (&b->st_mtim) &&
+    ns (&a->st_ctim) == ns (&b->st_ctim);
+}
+
+bool
+digest_cache_lookup (const struct stat *st, uint8_t *digest)
+{
+  struct digest_cache_entry key;
+  struct digest_cache_entry e;
+  uint8_t check[sizeof (e.check)];
+  unsigned int slot = 0;
+  unsigned int x = 0;
+
+  assert (NULL != st);
+  assert (NULL != digest);
+
+  if (NULL == cache || !S_ISREG (st->st_mode))
+    return false;
+
+  make_key (st, &key);
+  slot = home_slot (st);
+
+  for (x = 0; x < DIGEST_CACHE_PROBES; x++)
+    {
+      /* Copy first, another process may be writing the entry */
+      memcpy (&e, &cache->entries[(slot + x) & (DIGEST_CACHE_ENTRIES - 1)],
+              sizeof (e));
+
+      if (e.dev != key.dev || e.ino != key.ino)
+        continue;
+
+      entry_check (&e, check);
+
+      if (0 != memcmp (check, e.check, sizeof (check)) ||
+          0 != memcmp (&e, &key, offsetof (struct digest_cache_entry, digest)))
+        return false;
+
+      memcpy (digest, e.digest, sizeof (e.digest));
+      return true;
+    }
+
+  return false;
+}
+
+void
+digest_cache_store (const struct stat *st, const uint8_t *digest)
+{
+  struct digest_cache_entry e;
+  struct timespec now;
+  unsigned int slot = 0;
+  unsigned int x = 0;
+  unsigned int target = 0;
+
+  assert (NULL != st);
+  assert (NULL != digest);
+
+  if (NULL == cache || !S_ISREG (st->st_mode))
+    return;
+
+  clock_gettime (CLOCK_REALTIME, &now);
+
+  if (ns (&now) - ns (&st->st_mtim) < DIGEST_CACHE_RACY_NS ||
+      ns (&now) - ns (&st->st_ctim) < DIGEST_CACHE_RACY_NS)
+    return;
+
+  make_key (st, &e);
+  memcpy (e.digest, digest, sizeof (e.digest));
+  entry_check (&e, e.check);
+
+  /* Replace the file's old entry, else take an empty slot, else
+     evict from the home slot */
+  slot = home_slot (st);
+  target = slot;
+
+  for (x = 0; x < DIGEST_CACHE_PROBES; x++)
+    {
+      struct digest_cache_entry *cur =
+        &cache->entries[(slot + x) & (DIGEST_CACHE_ENTRIES - 1)];
+
+      if (cur->dev == e.dev && cur->ino == e.ino)
+        {
+          target = (slot + x) & (DIGEST_CACHE_ENTRIES - 1);
+          break;
+        }
+
+      if (0 == cur->ino && 0 == cur->dev && target == slot &&
+          0 != cache->entries[slot].ino)
+        target = (slot + x) & (DIGEST_CACHE_ENTRIES - 1);
+    }
+
+  memcpy (&cache->entries[target], &e, sizeof (e));
+}
@@ -0,0 +1,93 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DIGEST_CACHE_H
+#define DIGEST_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#define DIGEST_CACHE_FILE "digests"
+#define DIGEST_CACHE_MAGIC "ECLET-DIGESTS 2"
+
+/* The key entries are checked with, in the config directory rather
+   than the cache */
+#define DIGEST_CACHE_KEY_FILE "digest-cache.key"
+#define DIGEST_CACHE_KEY_LEN 32
+
+/* Power of two, about 5 MB on disk */
+#define DIGEST_CACHE_ENTRIES 65536
+
+/* Slots searched from a file's home slot */
+#define DIGEST_CACHE_PROBES 4
+
+/* Files changed this recently when hashed are not cached, since a
+   further change within the timestamp granularity would go unseen */
+#define DIGEST_CACHE_RACY_NS (2 * 1000000000LL)
+
+/**
+ * Use the digest cache in this process from now on.  Files hashed by
+ * digest_path and digest_paths are looked up by (device, inode, size,
+ * mtime, ctime) and are not read on a hit.  Entries carry an HMAC
+ * under a per user key, so an entry written by anyone without the key
+ * is a miss rather than a digest for a file it doesn't describe.
+ *
+ * @return false if the cache or its key can't be used, hashing still
+ * works
+ */
+bool digest_cache_open (void);
+
+void digest_cache_close (void);
+
+/**
+ * Whether digest_cache_open succeeded, so callers can skip the stat
+ * a lookup needs when there is nothing to look up.
+ */
+bool digest_cache_enabled (void);
+
+/**
+ * Look up a file's digest.
+ *
+ * @param st The file's current status
+ * @param digest Filled with the 32 byte digest on a hit
+ *
+ * @return true on a hit
+ */
+bool digest_cache_lookup (const struct stat *st, uint8_t *digest);
+
+/**
+ * Remember a file's digest.  Nothing is stored if the cache is not
+ * open, the file is not regular, or it changed too recently to trust
+ * its timestamps.
+ *
+ * @param st The file's status from before it was read, which must
+ * still be current after the read
+ * @param digest The 32 byte digest
+ */
+void digest_cache_store (const struct stat *st, const uint8_t *digest);
+
+/**
+ * Whether two status results describe the same file contents as far
+ * as the cache can tell.
+ */
+bool digest_cache_same (const struct stat *a, const struct stat *b);
+
+#endif /* DIGEST_CACHE_H */
@@ -0,0 +1,408 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "digest_cache.h"
+#include "file_digest.h"
+#include "../crypto/sha256.h"
+#include "../crypto/sha256_mb.h"
+
+/* Set while this thread reads a mapping.  A file truncated under the
+   mapping raises SIGBUS, which jumps back to hash_mapped. */
+static __thread sigjmp_buf *mapped_jmp = NULL;
+static pthread_once_t bus_once = PTHREAD_ONCE_INIT;
+
+static void
+handle_bus (int sig)
+{
+  if (NULL != mapped_jmp)
+    siglongjmp (*mapped_jmp, 1);
+
+  /* Not ours, die as we would have without the handler */
+  signal (SIGBUS, SIG_DFL);
+  raise (SIGBUS);
+}
+
+static void
+install_bus_handler (void)
+{
+  struct sigaction sa;
+
+  memset (&sa, 0, sizeof (sa));
+  sa.sa_handler = handle_bus;
+  sigemptyset (&sa.sa_mask);
+  sigaction (SIGBUS, &sa, NULL);
+}
+
+/**
+ * Hash [start, end) of fd through mappings.
+ *
+ * @return false if the file can't be mapped, or shrank while it was
+ * hashed, in which case ctx holds part of the data
+ */
+static bool
+hash_mapped (int fd, off_t start, off_t end, struct sha256_ctx *ctx)
+{
+  off_t page = sysconf (_SC_PAGESIZE);
+  volatile off_t offset = start;
+  void * volatile map = MAP_FAILED;
+  volatile size_t map_len = 0;
+  sigjmp_buf jmp;
+
+  pthread_once (&bus_once, install_bus_handler);
+
+  if (0 != sigsetjmp (jmp, 1))
+    {
+      mapped_jmp = NULL;
+      munmap (map, map_len);
+      LCA_LOG (DEBUG, "File shrank while it was mapped");
+      return false;
+    }
+
+  while (offset < end)
+    {
+      /* Mappings start on a page boundary, skip up to the offset */
+      off_t base = offset - offset % page;
+      size_t skip = offset - base;
+      size_t len = end - offset < DIGEST_MAP_WINDOW ?
+        end - offset : DIGEST_MAP_WINDOW;
+
+      map_len = skip + len;
+      map = mmap (NULL, map_len, PROT_READ, MAP_PRIVATE, fd, base);
+
+      if (MAP_FAILED == map)
+        return false;
+
+      madvise (map, map_len, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+      /* Only honoured where the kernel supports huge pages for the
+         page cache, otherwise harmlessly refused */
+      madvise (map, map_len, MADV_HUGEPAGE);
+#endif
+
+      mapped_jmp = &jmp;
+      sha256_update (ctx, (uint8_t *)map + skip, len);
+      mapped_jmp = NULL;
+
+      munmap (map, map_len);
+      map = MAP_FAILED;
+
+      offset += len;
+    }
+
+  return true;
+}
+
+static bool
+hash_read (int fd, struct sha256_ctx *ctx)
+{
+  bool result = true;
+  void *buf = NULL;
+  ssize_t n = 0;
+
+  if (0 != posix_memalign (&buf, sysconf (_SC_PAGESIZE), DIGEST_READ_LEN))
+    return false;
+
+  while ((n = read (fd, buf, DIGEST_READ_LEN)) != 0)
+    {
+      if (n < 0)
+        {
+          if (EINTR == errno)
+            continue;
+
+          perror ("Failed to read input");
+          result = false;
+          break;
+        }
+
+      sha256_update (ctx, buf, n);
+    }
+
+  free (buf);
+
+  return result;
+}
+
+struct lca_octet_buffer
+digest_fd (int fd)
+{
+  uint64_t len = 0;
+
+  return digest_fd_len (fd, &len);
+}
+
+struct lca_octet_buffer
+digest_fd_len (int fd, uint64_t *len)
+{
+  struct lca_octet_buffer digest = {0,0};
+  struct sha256_ctx ctx;
+  struct stat st;
+  bool hashed = false;
+
+  sha256_init (&ctx);
+
+  if (0 == fstat (fd, &st) && S_ISREG (st.st_mode) && st.st_size > 0 &&
+      0 == lseek (fd, 0, SEEK_CUR))
+    {
+      hashed = hash_mapped (fd, 0, st.st_size, &ctx);
+
+      /* A file that can't be mapped, or shrank, is read instead.
+         Mapping leaves the file offset at the start. */
+      if (!hashed)
+        {
+          sha256_init (&ctx);
+          hashed = hash_read (fd, &ctx);
+        }
+    }
+  else
+    {
+#ifdef POSIX_FADV_SEQUENTIAL
+      posix_fadvise (fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+      hashed = hash_read (fd, &ctx);
+    }
+
+  if (hashed)
+    {
+      *len = ctx.len;
+      digest = lca_make_buffer (SHA256_DIGEST_LEN);
+      sha256_final (&ctx, digest.ptr);
+    }
+
+  return digest;
+}
+
+bool
+digest_fd_range (int fd, off_t start, off_t end, struct sha256_ctx *ctx)
+{
+  uint64_t before = 0;
+  uint8_t buf[SHA256_BLOCK_LEN * 64];
+  ssize_t n = 0;
+
+  assert (NULL != ctx);
+  assert (start <= end);
+
+  before = ctx->len;
+
+  if (hash_mapped (fd, start, end, ctx))
+    return true;
+
+  /* Not mappable, read it instead unless part was already hashed */
+  if (ctx->len != before)
+    return false;
+
+  while (start < end)
+    {
+      size_t len = end - start < sizeof (buf) ? end - start : sizeof (buf);
+
+      if ((n = pread (fd, buf, len, start)) <= 0)
+        {
+          if (n < 0 && EINTR == errno)
+            continue;
+
+          return false;
+        }
+
+      sha256_update (ctx, buf, n);
+      start += n;
+    }
+
+  return true;
+}
+
+/**
+ * Cached digest of the file at path, which is not opened on a hit.
+ */
+static struct lca_octet_buffer
+cached_digest (const char *path)
+{
+  struct lca_octet_buffer digest = {0,0};
+  uint8_t cached[SHA256_DIGEST_LEN];
+  struct stat st;
+
+  if (digest_cache_enabled () && 0 == stat (path, &st) &&
+      digest_cache_lookup (&st, cached))
+    {
+      digest = lca_make_buffer (SHA256_DIGEST_LEN);
+      memcpy (digest.ptr, cached, SHA256_DIGEST_LEN);
+    }
+
+  return digest;
+}
+
+/**
+ * Cache a digest if the file did not change while it was read.
+ */
+static void
+cache_digest (int fd, const struct stat *before, const uint8_t *digest)
+{
+  struct stat after;
+
+  if (0 == fstat (fd, &after) && digest_cache_same (before, &after))
+    digest_cache_store (before, digest);
+}
+
+struct lca_octet_buffer
+digest_path (const char *path)
+{
+  struct lca_octet_buffer digest = {0,0};
+  struct stat st;
+  int fd = -1;
+
+  assert (NULL != path);
+
+  if ((digest = cached_digest (path)).ptr != NULL)
+    return digest;
+
+  if ((fd = open (path, O_RDONLY)) < 0)
+    {
+      perror (path);
+      return digest;
+    }
+
+  if (0 == fstat (fd, &st) && (digest = digest_fd (fd)).ptr != NULL)
+    cache_digest (fd, &st, digest.ptr);
+
+  close (fd);
+
+  return digest;
+}
+
+/**
+ * Read a small regular file whole.
+ *
+ * @return true with *data and *len set, or false if the file should be
+ * hashed by digest_fd instead
+ */
+static bool
+read_small (int fd, uint8_t **data, size_t *len, struct stat *st_out)
+{
+  struct stat st;
+  struct stat after;
+  ssize_t n = 0;
+
+  if (0 != fstat (fd, &st) || !S_ISREG (st.st_mode) ||
+      st.st_size > DIGEST_MB_FILE_MAX)
+    return false;
+
+  /* One spare byte so an empty file still gets a valid pointer */
+  if ((*data = malloc (st.st_size + 1)) == NULL)
+    return false;
+
+  *len = 0;
+
+  while (*len < st.st_size &&
+         ((n = read (fd, *data + *len, st.st_size - *len)) > 0 ||
+          (n < 0 && EINTR == errno)))
+    if (n > 0)
+      *len += n;
+
+  /* The file changed size under us, leave it to the general path
+     from the start */
+  if (n < 0 || *len != st.st_size)
+    {
+      free (*data);
+      lseek (fd, 0, SEEK_SET);
+      return false;
+    }
+
+  /* Only what was read unchanged may be cached */
+  if (0 == fstat (fd, &after) && digest_cache_same (&st, &after))
+    *st_out = st;
+  else
+    st_out->st_mode = 0;
+
+  return true;
+}
+
+void
+digest_paths (const char *const *paths, unsigned int n,
+              struct lca_octet_buffer *digests)
+{
+  const uint8_t **data = calloc (n, sizeof (uint8_t *));
+  size_t *len = calloc (n, sizeof (size_t));
+  uint8_t (*out)[SHA256_DIGEST_LEN] = calloc (n, SHA256_DIGEST_LEN);
+  unsigned int *index = calloc (n, sizeof (unsigned int));
+  struct stat *st = calloc (n, sizeof (struct stat));
+  unsigned int num_small = 0;
+  unsigned int x = 0;
+
+  assert (NULL != paths || 0 == n);
+  assert (NULL != digests || 0 == n);
+  assert (NULL != data && NULL != len && NULL != out && NULL != index);
+  assert (NULL != st);
+
+  for (x = 0; x < n; x++)
+    {
+      uint8_t *small = NULL;
+      struct stat big;
+      int fd = -1;
+
+      if ((digests[x] = cached_digest (paths[x])).ptr != NULL)
+        continue;
+
+      if ((fd = open (paths[x], O_RDONLY)) < 0)
+        {
+          perror (paths[x]);
+          continue;
+        }
+
+      if (read_small (fd, &small, &len[num_small], &st[num_small]))
+        {
+          data[num_small] = small;
+          index[num_small++] = x;
+        }
+      else if (0 == fstat (fd, &big) &&
+               (digests[x] = digest_fd (fd)).ptr != NULL)
+        cache_digest (fd, &big, digests[x].ptr);
+
+      close (fd);
+    }
+
+  sha256_mb (data, len, out, num_small);
+
+  for (x = 0; x < num_small; x++)
+    {
+      digests[index[x]] = lca_make_buffer (SHA256_DIGEST_LEN);
+      memcpy (digests[index[x]].ptr, out[x], SHA256_DIGEST_LEN);
+      free ((void *)data[x]);
+
+      if (S_ISREG (st[x].st_mode))
+        digest_cache_store (&st[x], out[x]);
+    }
+
+  free (st);
+  free (index);
+  free (out);
+  free (len);
+  free (data);
+}
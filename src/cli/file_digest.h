@@ -0,0 +1,98 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef FILE_DIGEST_H
+#define FILE_DIGEST_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <libcryptoauth.h>
+
+#include "../crypto/sha256.h"
+
+/* Regular files are hashed straight from the page cache through a
+   mapping this large at a time, which also keeps 32 bit address
+   spaces happy with multi gigabyte files. */
+#define DIGEST_MAP_WINDOW (64UL * 1024 * 1024)
+
+/* Pipes and other streams are read in page aligned chunks this big */
+#define DIGEST_READ_LEN (1024 * 1024)
+
+/* Regular files up to this size are read whole and hashed side by
+   side with others by the multi-buffer engine */
+#define DIGEST_MB_FILE_MAX (64 * 1024)
+
+/**
+ * SHA256 the file at path.
+ *
+ * @param path The file to hash
+ *
+ * @return The 32 byte digest, which must be freed, or a NULL buffer
+ * if the file could not be read.
+ */
+struct lca_octet_buffer digest_path (const char *path);
+
+/**
+ * SHA256 everything from the descriptor's current position to the
+ * end of the file.
+ *
+ * @param fd The open descriptor, which is left open
+ *
+ * @return The 32 byte digest, which must be freed, or a NULL buffer
+ * on a read error.
+ */
+struct lca_octet_buffer digest_fd (int fd);
+
+/**
+ * digest_fd that also reports how much was hashed.
+ *
+ * @param fd The open descriptor, which is left open
+ * @param len Set to the number of bytes hashed
+ *
+ * @return As digest_fd
+ */
+struct lca_octet_buffer digest_fd_len (int fd, uint64_t *len);
+
+/**
+ * Feed bytes start up to end of a regular file into a running hash.
+ *
+ * @param fd The open file
+ * @param start The first byte
+ * @param end One past the last byte, at most the file size
+ * @param ctx The hash to update
+ *
+ * @return false on a read error, with the hash in an unknown state
+ */
+bool digest_fd_range (int fd, off_t start, off_t end,
+                      struct sha256_ctx *ctx);
+
+/**
+ * SHA256 several files.  Small files are hashed together with
+ * sha256_mb, the rest one at a time as digest_path does.
+ *
+ * @param paths The files to hash
+ * @param n The number of files
+ * @param digests Filled with each file's digest, which must be freed,
+ * or a NULL buffer for a file that could not be read.
+ */
+void digest_paths (const char *const *paths, unsigned int n,
+                   struct lca_octet_buffer *digests);
+
+#endif /* FILE_DIGEST_H */
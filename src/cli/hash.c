@@ -0,0 +1,235 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file   hash.c
+ *
+ * @brief  SHA256 of files or stdin on the host or on the device, with
+ * a throughput report to judge whether the device is ever worth it.
+ */
+
+#include <assert.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "cli_commands.h"
+#include "batch.h"
+#include "file_digest.h"
+#include "../crypto/sha256.h"
+#include "../crypto/sha256_mb.h"
+#include "../driver/device_sha.h"
+#include <libcryptoauth.h>
+
+struct hash_stats
+{
+  struct timespec start;
+  unsigned long files;
+  uint64_t bytes;
+};
+
+static double
+elapsed (const struct timespec *start)
+{
+  struct timespec now;
+
+  clock_gettime (CLOCK_MONOTONIC, &now);
+
+  return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void
+print_stats (const struct hash_stats *stats, bool device)
+{
+  double secs = elapsed (&stats->start);
+  char engine[64];
+
+  if (device)
+    snprintf (engine, sizeof (engine), "%s", ENGINE_DEVICE);
+  else if (sha256_mb_lanes () > 1 && stats->files > 1)
+    snprintf (engine, sizeof (engine), "%s %s, %s x%u", ENGINE_HOST,
+              sha256_engine (), sha256_mb_engine (), sha256_mb_lanes ());
+  else
+    snprintf (engine, sizeof (engine), "%s %s", ENGINE_HOST, sha256_engine ());
+
+  if (secs <= 0)
+    secs = 1e-9;
+
+  fprintf (stderr, "%lu files, %llu bytes in %.3f s: %.2f MB/s, "
+           "%.1f files/s (%s)\n", stats->files,
+           (unsigned long long)stats->bytes, secs, stats->bytes / secs / 1e6,
+           stats->files / secs, engine);
+}
+
+static struct lca_octet_buffer
+hash_fd (int fd, int in, bool device, uint64_t *len)
+{
+  if (device)
+    return device_sha256_fd (fd, in, len);
+  else
+    return digest_fd_len (in, len);
+}
+
+static struct lca_octet_buffer
+hash_file (int fd, const char *path, bool device, uint64_t *len)
+{
+  struct lca_octet_buffer digest = {0,0};
+  int in = -1;
+
+  if ((in = open (path, O_RDONLY)) < 0)
+    {
+      perror (path);
+      return digest;
+    }
+
+  digest = hash_fd (fd, in, device, len);
+  close (in);
+
+  return digest;
+}
+
+static bool
+print_batch_entry (const char *path, struct lca_octet_buffer digest,
+                   void *ctx)
+{
+  struct hash_stats *stats = ctx;
+  struct stat st;
+
+  if (NULL == digest.ptr)
+    return false;
+
+  fprintf (stdout, "%s\t", path);
+  output_hex (stdout, digest);
+
+  stats->files++;
+
+  if (0 == stat (path, &st))
+    stats->bytes += st.st_size;
+
+  return true;
+}
+
+/**
+ * The device has one SHA engine, so a batch goes through it one file
+ * at a time.
+ */
+static bool
+device_batch (int fd, const char *list_path, struct hash_stats *stats)
+{
+  bool result = true;
+  FILE *list = NULL;
+  char *line = NULL;
+  size_t n = 0;
+  const char *path = NULL;
+
+  if ((list = fopen (list_path, "r")) == NULL)
+    {
+      perror ("Failed to open batch list");
+      return false;
+    }
+
+  while ((path = next_list_entry (list, &line, &n)) != NULL)
+    {
+      uint64_t len = 0;
+      struct lca_octet_buffer digest = hash_file (fd, path, true, &len);
+
+      if (NULL == digest.ptr)
+        {
+          fprintf (stderr, "%s: %s\n", path, "Hash failed");
+          result = false;
+          continue;
+        }
+
+      fprintf (stdout, "%s\t", path);
+      output_hex (stdout, digest);
+      lca_free_octet_buffer (digest);
+
+      stats->files++;
+      stats->bytes += len;
+    }
+
+  free (line);
+  fclose (list);
+
+  return result;
+}
+
+bool
+hash_on_device (const struct arguments *args)
+{
+  assert (NULL != args);
+
+  return NULL != args->engine && 0 == strcmp (args->engine, ENGINE_DEVICE);
+}
+
+int
+cli_hash (int fd, struct arguments *args)
+{
+  int result = HASHLET_COMMAND_FAIL;
+  struct hash_stats stats = { {0,0}, 0, 0 };
+  bool device = false;
+
+  assert (NULL != args);
+
+  if (NULL != args->engine && 0 != strcmp (args->engine, ENGINE_HOST) &&
+      0 != strcmp (args->engine, ENGINE_DEVICE))
+    {
+      fprintf (stderr, "%s\n", "The hash engine must be host or device");
+      return result;
+    }
+
+  device = hash_on_device (args);
+  clock_gettime (CLOCK_MONOTONIC, &stats.start);
+
+  if (NULL != args->batch)
+    {
+      bool hashed = device ? device_batch (fd, args->batch, &stats) :
+        digest_list (args->batch, args->jobs, print_batch_entry, &stats);
+
+      if (hashed)
+        result = HASHLET_COMMAND_SUCCESS;
+    }
+  else
+    {
+      struct lca_octet_buffer digest = {0,0};
+
+      if (NULL != args->input_file)
+        digest = hash_file (fd, args->input_file, device, &stats.bytes);
+      else
+        digest = hash_fd (fd, STDIN_FILENO, device, &stats.bytes);
+
+      if (NULL != digest.ptr)
+        {
+          output_hex (stdout, digest);
+          lca_free_octet_buffer (digest);
+          stats.files = 1;
+          result = HASHLET_COMMAND_SUCCESS;
+        }
+      else
+        fprintf (stderr, "%s\n", "Hash failed");
+    }
+
+  if (args->stats)
+    print_stats (&stats, device);
+
+  return result;
+}
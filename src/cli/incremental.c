@@ -0,0 +1,429 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file   incremental.c
+ *
+ * @brief  Resumable SHA256 of append only files, so re-signing a
+ * growing log only costs the appended bytes.
+ *
+ * The sidecar is text:
+ *
+ *   ECLET-MIDSTATE 2
+ *   file DEV INODE
+ *   offset OFFSET
+ *   state STATE
+ *   head HEAD
+ *   tail TAIL
+ *   mac MAC
+ *
+ * The chaining value decides which digest the device signs, and the
+ * head and tail checks are only hashes of the file, so the sidecar
+ * carries an HMAC of the lines above it under a per user key, as the
+ * digest cache does.  It is only read if it is a regular file, not a
+ * link, owned by the user and not writable by anyone else.  A sidecar
+ * that fails any of this is ignored and the whole file is hashed.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "cache_file.h"
+#include "cli_commands.h"
+#include "file_digest.h"
+#include "incremental.h"
+#include "../crypto/sha256.h"
+
+static char *
+sidecar_path (const char *path, const char *suffix)
+{
+  size_t len = strlen (path) + strlen (MIDSTATE_SUFFIX) + strlen (suffix) + 1;
+  char *sidecar = malloc (len);
+
+  assert (NULL != sidecar);
+  snprintf (sidecar, len, "%s%s%s", path, MIDSTATE_SUFFIX, suffix);
+
+  return sidecar;
+}
+
+/**
+ * SHA256 of bytes start up to end of the file.
+ */
+static bool
+hash_range (int fd, off_t start, off_t end, uint8_t *digest)
+{
+  struct sha256_ctx ctx;
+
+  sha256_init (&ctx);
+
+  if (!digest_fd_range (fd, start, end, &ctx))
+    return false;
+
+  sha256_final (&ctx, digest);
+
+  return true;
+}
+
+/**
+ * Fill in the boundary check for a state saved at m->offset.
+ */
+static bool
+boundary_check (int fd, const struct midstate *m, uint8_t *head,
+                uint8_t *tail)
+{
+  uint64_t check = m->offset < MIDSTATE_CHECK_LEN ?
+    m->offset : MIDSTATE_CHECK_LEN;
+
+  return hash_range (fd, 0, check, head) &&
+    hash_range (fd, m->offset - check, m->offset, tail);
+}
+
+static bool
+read_hex_line (FILE *f, const char *key, uint8_t *out, unsigned int len)
+{
+  char line[128];
+  size_t key_len = strlen (key);
+  struct lca_octet_buffer bin;
+
+  if (NULL == fgets (line, sizeof (line), f))
+    return false;
+
+  line[strcspn (line, "\r\n")] = '\0';
+
+  if (0 != strncmp (line, key, key_len) || ' ' != line[key_len] ||
+      !is_hex_arg (line + key_len + 1, 2 * len))
+    return false;
+
+  bin = lca_ascii_hex_2_bin (line + key_len + 1, 2 * len);
+  memcpy (out, bin.ptr, len);
+  lca_free_octet_buffer (bin);
+
+  return true;
+}
+
+/**
+ * HMAC the sidecar's lines under the user's key.
+ */
+static bool
+midstate_mac (const char *text, size_t len, uint8_t *mac)
+{
+  uint8_t key[MIDSTATE_KEY_LEN];
+
+  if (!config_secret (MIDSTATE_KEY_FILE, key, sizeof (key)))
+    return false;
+
+  hmac_sha256 (key, sizeof (key), text, len, mac);
+  memset (key, 0, sizeof (key));
+
+  return true;
+}
+
+/**
+ * Read the sidecar if it is the user's own and its MAC matches.
+ *
+ * @return The length of the text before the mac line, or 0
+ */
+static size_t
+read_sidecar (const char *sidecar, char *buf, size_t len)
+{
+  uint8_t mac[SHA256_DIGEST_LEN];
+  uint8_t expected[SHA256_DIGEST_LEN];
+  struct lca_octet_buffer bin;
+  struct stat st;
+  ssize_t got = 0;
+  char *line = NULL;
+  size_t body = 0;
+  int fd = -1;
+
+  if ((fd = open (sidecar, O_RDONLY | O_NOFOLLOW)) < 0)
+    {
+      if (ENOENT != errno)
+        fprintf (stderr, "%s: %s\n", sidecar, "Can't open, ignored");
+      return 0;
+    }
+
+  if (0 != fstat (fd, &st) || !S_ISREG (st.st_mode) ||
+      st.st_uid != geteuid () || 0 != (st.st_mode & (S_IWGRP | S_IWOTH)))
+    {
+      fprintf (stderr, "%s: %s\n", sidecar, "Not private to the user, ignored");
+      close (fd);
+      return 0;
+    }
+
+  got = read (fd, buf, len - 1);
+  close (fd);
+
+  if (got <= 0)
+    return 0;
+
+  buf[got] = '\0';
+
+  /* The mac line is the last one and covers everything before it */
+  if (NULL == (line = strstr (buf, "\nmac ")))
+    return 0;
+
+  body = line + 1 - buf;
+  line += strlen ("\nmac ");
+  line[strcspn (line, "\r\n")] = '\0';
+
+  if (!is_hex_arg (line, 2 * sizeof (mac)) ||
+      !midstate_mac (buf, body, expected))
+    return 0;
+
+  bin = lca_ascii_hex_2_bin (line, 2 * sizeof (mac));
+  memcpy (mac, bin.ptr, sizeof (mac));
+  lca_free_octet_buffer (bin);
+
+  if (0 != memcmp (mac, expected, sizeof (mac)))
+    {
+      fprintf (stderr, "%s: %s\n", sidecar, "Failed its check, ignored");
+      return 0;
+    }
+
+  return body;
+}
+
+static bool
+load_midstate (const char *path, struct midstate *m)
+{
+  char *sidecar = sidecar_path (path, "");
+  char text[MIDSTATE_MAX_LEN];
+  size_t body = read_sidecar (sidecar, text, sizeof (text));
+  FILE *f = NULL;
+  char line[128];
+  uintmax_t dev = 0, ino = 0;
+  uint8_t state[32];
+  bool result = false;
+  unsigned int x = 0;
+
+  free (sidecar);
+
+  if (0 == body || (f = fmemopen (text, body, "r")) == NULL)
+    return false;
+
+  if (NULL != fgets (line, sizeof (line), f) &&
+      0 == strncmp (line, MIDSTATE_MAGIC "\n", sizeof (MIDSTATE_MAGIC)) &&
+      NULL != fgets (line, sizeof (line), f) &&
+      2 == sscanf (line, "file %ju %ju", &dev, &ino) &&
+      NULL != fgets (line, sizeof (line), f) &&
+      1 == sscanf (line, "offset %" SCNu64, &m->offset) &&
+      0 == m->offset % SHA256_BLOCK_LEN &&
+      read_hex_line (f, "state", state, sizeof (state)) &&
+      read_hex_line (f, "head", m->head, sizeof (m->head)) &&
+      read_hex_line (f, "tail", m->tail, sizeof (m->tail)))
+    {
+      m->dev = dev;
+      m->ino = ino;
+
+      for (x = 0; x < 8; x++)
+        m->state[x] = (uint32_t)state[4 * x] << 24 |
+          (uint32_t)state[4 * x + 1] << 16 |
+          (uint32_t)state[4 * x + 2] << 8 | state[4 * x + 3];
+
+      result = true;
+    }
+
+  fclose (f);
+
+  return result;
+}
+
+/**
+ * Whether the saved state still describes the start of the file.
+ */
+static bool
+can_resume (int fd, const struct stat *st, const struct midstate *saved)
+{
+  uint8_t head[32];
+  uint8_t tail[32];
+
+  if (saved->dev != st->st_dev || saved->ino != st->st_ino)
+    return false;
+
+  if (saved->offset > (uint64_t)st->st_size)
+    return false;
+
+  return boundary_check (fd, saved, head, tail) &&
+    0 == memcmp (head, saved->head, sizeof (head)) &&
+    0 == memcmp (tail, saved->tail, sizeof (tail));
+}
+
+struct lca_octet_buffer
+incremental_digest (const char *path, struct midstate *next)
+{
+  struct lca_octet_buffer digest = {0,0};
+  struct midstate saved;
+  struct sha256_ctx ctx;
+  struct stat st;
+  uint64_t end = 0;
+  int fd = -1;
+
+  assert (NULL != path);
+  assert (NULL != next);
+
+  if ((fd = open (path, O_RDONLY)) < 0)
+    {
+      perror (path);
+      return digest;
+    }
+
+  if (0 != fstat (fd, &st) || !S_ISREG (st.st_mode))
+    {
+      fprintf (stderr, "%s: %s\n", path, "Not a regular file");
+      close (fd);
+      return digest;
+    }
+
+  sha256_init (&ctx);
+
+  if (load_midstate (path, &saved))
+    {
+      if (can_resume (fd, &st, &saved))
+        {
+          LCA_LOG (DEBUG, "Resuming at offset %" PRIu64, saved.offset);
+          sha256_resume (&ctx, saved.state, saved.offset);
+        }
+      else
+        fprintf (stderr, "%s: %s\n", path,
+                 "Changed since the last run, hashing the whole file");
+    }
+
+  /* Stop at the last block boundary to save the state there, then
+     finish on a copy */
+  end = st.st_size - st.st_size % SHA256_BLOCK_LEN;
+
+  if (digest_fd_range (fd, ctx.len, end, &ctx))
+    {
+      struct sha256_ctx tail = ctx;
+
+      next->dev = st.st_dev;
+      next->ino = st.st_ino;
+      next->offset = end;
+      memcpy (next->state, ctx.state, sizeof (next->state));
+
+      if (digest_fd_range (fd, end, st.st_size, &tail) &&
+          boundary_check (fd, next, next->head, next->tail))
+        {
+          digest = lca_make_buffer (SHA256_DIGEST_LEN);
+          sha256_final (&tail, digest.ptr);
+        }
+    }
+
+  if (NULL == digest.ptr)
+    fprintf (stderr, "%s: %s\n", path, "Failed to read");
+
+  close (fd);
+
+  return digest;
+}
+
+static int
+sprint_hex (char *buf, size_t len, const char *key, const uint8_t *p,
+            unsigned int n)
+{
+  int used = snprintf (buf, len, "%s ", key);
+  unsigned int x = 0;
+
+  for (x = 0; x < n; x++)
+    used += snprintf (buf + used, len - used, "%02X", p[x]);
+
+  used += snprintf (buf + used, len - used, "\n");
+
+  return used;
+}
+
+bool
+save_midstate (const char *path, const struct midstate *m)
+{
+  char *sidecar = sidecar_path (path, "");
+  char *tmp = sidecar_path (path, ".tmp");
+  char text[MIDSTATE_MAX_LEN];
+  uint8_t state[32];
+  uint8_t mac[SHA256_DIGEST_LEN];
+  bool result = false;
+  FILE *f = NULL;
+  unsigned int x = 0;
+  int used = 0;
+  int fd = -1;
+
+  assert (NULL != m);
+
+  for (x = 0; x < 8; x++)
+    {
+      state[4 * x] = m->state[x] >> 24;
+      state[4 * x + 1] = m->state[x] >> 16;
+      state[4 * x + 2] = m->state[x] >> 8;
+      state[4 * x + 3] = m->state[x];
+    }
+
+  used = snprintf (text, sizeof (text), "%s\nfile %ju %ju\noffset %" PRIu64
+                   "\n", MIDSTATE_MAGIC, (uintmax_t)m->dev,
+                   (uintmax_t)m->ino, m->offset);
+  used += sprint_hex (text + used, sizeof (text) - used, "state", state,
+                      sizeof (state));
+  used += sprint_hex (text + used, sizeof (text) - used, "head", m->head,
+                      sizeof (m->head));
+  used += sprint_hex (text + used, sizeof (text) - used, "tail", m->tail,
+                      sizeof (m->tail));
+
+  if (!midstate_mac (text, used, mac))
+    {
+      fprintf (stderr, "%s: %s\n", sidecar, "No key to protect the state");
+      free (tmp);
+      free (sidecar);
+      return false;
+    }
+
+  used += sprint_hex (text + used, sizeof (text) - used, "mac", mac,
+                      sizeof (mac));
+  assert ((size_t)used < sizeof (text));
+
+  /* Written aside and renamed, so a crash never leaves half a state */
+  if ((fd = open (tmp, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW, 0600)) < 0 ||
+      (f = fdopen (fd, "w")) == NULL)
+    {
+      perror (tmp);
+
+      if (fd >= 0)
+        close (fd);
+    }
+  else
+    {
+      fputs (text, f);
+
+      if (0 == fclose (f) && 0 == rename (tmp, sidecar))
+        result = true;
+      else
+        {
+          perror (sidecar);
+          unlink (tmp);
+        }
+    }
+
+  free (tmp);
+  free (sidecar);
+
+  return result;
+}
@@ -0,0 +1,84 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <libcryptoauth.h>
+
+#define MIDSTATE_MAGIC "ECLET-MIDSTATE 2"
+#define MIDSTATE_SUFFIX ".sha256state"
+
+/* The sidecar's HMAC key, in the config directory */
+#define MIDSTATE_KEY_FILE "midstate.key"
+#define MIDSTATE_KEY_LEN 32
+
+/* A sidecar is a few hundred bytes, anything longer is not one */
+#define MIDSTATE_MAX_LEN 1024
+
+/* Bytes at the start of the file and just before the saved offset
+   that must be unchanged to resume */
+#define MIDSTATE_CHECK_LEN 4096
+
+/* Where hashing an append only file stopped last time */
+struct midstate
+{
+  dev_t dev;
+  ino_t ino;
+  uint64_t offset;              /**< Bytes hashed, a block multiple */
+  uint32_t state[8];            /**< SHA256 chaining value at offset */
+  uint8_t head[32];             /**< SHA256 of the first check bytes */
+  uint8_t tail[32];             /**< SHA256 of the check bytes before offset */
+};
+
+/**
+ * SHA256 a file that only grows, starting from the state saved in
+ * its sidecar when the sidecar is the user's own and its MAC matches,
+ * the file is still the same one and the boundary check passes.
+ * Otherwise the whole file is hashed.
+ *
+ * Only the bytes around the start and the saved offset are compared,
+ * so an edit in the middle of the already hashed part is not
+ * noticed.  Use this for append only files.
+ *
+ * @param path The file
+ * @param next Filled with the state to save once the digest is used
+ *
+ * @return The 32 byte digest, which must be freed, or a NULL buffer
+ * on error
+ */
+struct lca_octet_buffer incremental_digest (const char *path,
+                                            struct midstate *next);
+
+/**
+ * Write the sidecar, PATH.sha256state, readable only by its owner
+ * and with an HMAC under the key in MIDSTATE_KEY_FILE.
+ *
+ * @param path The hashed file
+ * @param m The state from incremental_digest
+ *
+ * @return true on success
+ */
+bool save_midstate (const char *path, const struct midstate *m);
+
+#endif /* INCREMENTAL_H */
@@ -0,0 +1,181 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file   inventory.c
+ *
+ * @brief  Everything there is to know about a board in one session.
+ *
+ * The record is one line of JSON:
+ *
+ *   {"serial":HEX,"state":STATE,"config":HEX,"otp":HEX,
+ *    "slots":[{"read_key":N,...,"write":MODE},...],
+ *    "pub_keys":{"SLOT":HEX,...}}
+ *
+ * The zones are read in 32 byte blocks, four for the config zone and
+ * two for the OTP zone.  The serial number, state and the decoded
+ * slot configs come out of the config zone, so they cost nothing
+ * more.  Each P256 private key slot
+ * then needs one GenKey, or none when --pub-key-cache has its key.
+ * "otp" is null until the device is personalized, as for get-otp, and
+ * a slot whose key can't be computed is null too.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cli_commands.h"
+#include "../driver/config_zone.h"
+#include <libcryptoauth.h>
+
+/* The serial number is split around the revision number */
+#define SERIAL_LEN 9
+
+static void
+print_hex (const uint8_t *buf, unsigned int len)
+{
+  unsigned int x = 0;
+
+  putchar ('"');
+  for (x = 0; x < len; x++)
+    printf ("%02X", buf[x]);
+  putchar ('"');
+}
+
+static const char *
+write_name (enum WRITE_CONFIG write_config)
+{
+  switch (write_config)
+    {
+    case ALWAYS:
+      return "always";
+    case ENCRYPT:
+      return "encrypt";
+    default:
+      return "never";
+    }
+}
+
+static const char *
+bool_name (bool b)
+{
+  return b ? "true" : "false";
+}
+
+static void
+print_slot_configs (const uint8_t *config)
+{
+  struct slot_config slots[MAX_NUM_DATA_SLOTS];
+  unsigned int x = 0;
+
+  decode_slot_configs (config, slots);
+
+  printf (",\"slots\":[");
+  for (x = 0; x < MAX_NUM_DATA_SLOTS; x++)
+    {
+      const struct slot_config *s = &slots[x];
+
+      printf ("%s{\"read_key\":%u,\"check_only\":%s,\"single_use\":%s,"
+              "\"encrypted_read\":%s,\"secret\":%s,\"write_key\":%u,"
+              "\"derive_key\":%s,\"write\":\"%s\"}",
+              0 == x ? "" : ",", s->read_key, bool_name (s->check_only),
+              bool_name (s->single_use), bool_name (s->encrypted_read),
+              bool_name (s->is_secret), s->write_key,
+              bool_name (s->derive_key), write_name (s->write_config));
+    }
+  putchar (']');
+}
+
+static const char *
+state_name (enum DEVICE_STATE state)
+{
+  switch (state)
+    {
+    case STATE_FACTORY:
+      return "Factory";
+    case STATE_INITIALIZED:
+      return "Initialized";
+    default:
+      return "Personalized";
+    }
+}
+
+int
+cli_inventory (int fd, struct arguments *args)
+{
+  uint8_t config[CONFIG_ZONE_LEN];
+  uint8_t otp[OTP_ZONE_LEN];
+  uint8_t serial[SERIAL_LEN];
+  enum DEVICE_STATE state;
+  bool first = true;
+  unsigned int slot = 0;
+
+  assert (NULL != args);
+
+  if (!read_zone (fd, CONFIG_ZONE, config, sizeof (config)))
+    {
+      fprintf (stderr, "%s\n", "Failed to read the config zone");
+      return HASHLET_COMMAND_FAIL;
+    }
+
+  memcpy (serial, config, 4);
+  memcpy (serial + 4, config + 8, SERIAL_LEN - 4);
+  state = config_zone_state (config);
+
+  printf ("{\"serial\":");
+  print_hex (serial, sizeof (serial));
+  printf (",\"state\":\"%s\",\"config\":", state_name (state));
+  print_hex (config, sizeof (config));
+
+  printf (",\"otp\":");
+  if (STATE_PERSONALIZED == state &&
+      read_zone (fd, OTP_ZONE, otp, sizeof (otp)))
+    print_hex (otp, sizeof (otp));
+  else
+    printf ("null");
+
+  print_slot_configs (config);
+
+  printf (",\"pub_keys\":{");
+  for (slot = 0; slot < MAX_NUM_DATA_SLOTS; slot++)
+    {
+      uint8_t key_config = config[CONFIG_KEY_CONFIG + 2 * slot];
+      struct lca_octet_buffer pub_key = {0,0};
+
+      if (!(key_config & KEY_CONFIG_PRIVATE_MASK) ||
+          KEY_TYPE_P256 != KEY_CONFIG_KEY_TYPE (key_config))
+        continue;
+
+      printf ("%s\"%u\":", first ? "" : ",", slot);
+      first = false;
+
+      if ((pub_key = get_pub_key (fd, slot)).ptr != NULL)
+        {
+          print_hex (pub_key.ptr, pub_key.len);
+          lca_free_octet_buffer (pub_key);
+        }
+      else
+        printf ("null");
+    }
+  printf ("}}\n");
+
+  return HASHLET_COMMAND_SUCCESS;
+}
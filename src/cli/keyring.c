@@ -0,0 +1,237 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file   keyring.c
+ *
+ * @brief  A persistent, memory mapped store of P-256 fixed window
+ * tables, keyed by the SHA256 fingerprint of the public key.
+ *
+ * Each slot goes from empty to busy to ready.  A writer claims an
+ * empty slot with a compare and swap on its lease, which works across
+ * threads and processes sharing the mapping, and only publishes the
+ * slot once the table is complete.  The lease records when the slot
+ * was claimed, so a slot whose writer died is taken over once the
+ * claim is stale, and a writer whose claim was taken over doesn't
+ * publish.
+ *
+ * A table decides which signatures verify, so each carries an HMAC
+ * of its fingerprint and contents under a per user key, as the verify
+ * cache does.  A table is checked the first time a process uses it,
+ * and one planted or copied in without the key is never used.
+ */
+
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+
+#include "cache_file.h"
+#include "keyring.h"
+#include "../crypto/sha256.h"
+#include <libcryptoauth.h>
+
+enum keyring_state
+  {
+    KEYRING_EMPTY = 0,
+    KEYRING_BUSY,               /**< Being written, or its writer died */
+    KEYRING_READY
+  };
+
+/* A lease holds the state in its low bits and the claim time, in
+   seconds, above them */
+#define LEASE_STATE_BITS 2
+#define LEASE(state, when) (((uint64_t)(when) << LEASE_STATE_BITS) | (state))
+#define LEASE_STATE(lease) ((lease) & ((1 << LEASE_STATE_BITS) - 1))
+#define LEASE_TIME(lease) ((int64_t)((lease) >> LEASE_STATE_BITS))
+
+struct keyring_slot
+{
+  uint64_t lease;
+  uint8_t fingerprint[SHA256_DIGEST_LEN];
+  uint8_t tag[SHA256_DIGEST_LEN]; /**< HMAC of fingerprint and table */
+};
+
+struct keyring
+{
+  struct cache_header header;
+  struct keyring_slot slots[KEYRING_ENTRIES];
+  struct p256_table tables[KEYRING_ENTRIES];
+};
+
+static struct keyring *keyring = NULL;
+static uint8_t keyring_key[KEYRING_KEY_LEN];
+
+/* One bit per slot whose table passed its check in this process */
+static uint32_t checked = 0;
+
+bool
+keyring_open (void)
+{
+  if (NULL != keyring)
+    return true;
+
+  if (!config_secret (KEYRING_KEY_FILE, keyring_key, sizeof (keyring_key)))
+    return false;
+
+  keyring = cache_file_map (KEYRING_FILE, KEYRING_MAGIC,
+                            sizeof (struct keyring));
+
+  return NULL != keyring;
+}
+
+void
+keyring_close (void)
+{
+  cache_file_unmap (keyring, sizeof (struct keyring));
+  keyring = NULL;
+  memset (keyring_key, 0, sizeof (keyring_key));
+  __atomic_store_n (&checked, 0, __ATOMIC_RELAXED);
+}
+
+bool
+keyring_enabled (void)
+{
+  return NULL != keyring;
+}
+
+static int64_t
+now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_REALTIME, &ts);
+
+  return ts.tv_sec;
+}
+
+static void
+table_tag (const uint8_t *fingerprint, const struct p256_table *table,
+           uint8_t *tag)
+{
+  uint8_t msg[2 * SHA256_DIGEST_LEN];
+
+  /* The MAC covers the fingerprint and the table's digest */
+  memcpy (msg, fingerprint, SHA256_DIGEST_LEN);
+  sha256 (table, sizeof (*table), msg + SHA256_DIGEST_LEN);
+  hmac_sha256 (keyring_key, sizeof (keyring_key), msg, sizeof (msg), tag);
+}
+
+/**
+ * The slot's table, once its tag has been checked in this process.
+ */
+static const struct p256_table *
+checked_table (unsigned int slot)
+{
+  const struct keyring_slot *s = &keyring->slots[slot];
+  uint8_t tag[SHA256_DIGEST_LEN];
+
+  if (__atomic_load_n (&checked, __ATOMIC_ACQUIRE) & (1U << slot))
+    return &keyring->tables[slot];
+
+  table_tag (s->fingerprint, &keyring->tables[slot], tag);
+
+  if (0 != memcmp (tag, s->tag, sizeof (tag)))
+    {
+      LCA_LOG (DEBUG, "Keyring table %u failed its check, not used", slot);
+      return NULL;
+    }
+
+  __atomic_fetch_or (&checked, 1U << slot, __ATOMIC_ACQ_REL);
+
+  return &keyring->tables[slot];
+}
+
+/**
+ * Claim a slot that is empty, or busy with a claim too old to still
+ * have a live writer.
+ *
+ * @return The lease now held, or 0 if the slot wasn't claimed
+ */
+static uint64_t
+claim (struct keyring_slot *s, uint64_t lease)
+{
+  uint64_t mine = LEASE (KEYRING_BUSY, now ());
+
+  if (KEYRING_BUSY == LEASE_STATE (lease) &&
+      now () - LEASE_TIME (lease) < KEYRING_STALE_SECS)
+    return 0;
+
+  if (!__atomic_compare_exchange_n (&s->lease, &lease, mine, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    return 0;
+
+  return mine;
+}
+
+const struct p256_table *
+keyring_table (const uint8_t *pub_key)
+{
+  uint8_t fingerprint[SHA256_DIGEST_LEN];
+  unsigned int home = 0;
+  unsigned int x = 0;
+
+  assert (NULL != pub_key);
+
+  if (NULL == keyring)
+    return NULL;
+
+  sha256 (pub_key, P256_PUB_KEY_LEN, fingerprint);
+  home = fingerprint[0] % KEYRING_ENTRIES;
+
+  /* Probe from the home slot to the first empty one */
+  for (x = 0; x < KEYRING_ENTRIES; x++)
+    {
+      unsigned int slot = (home + x) % KEYRING_ENTRIES;
+      struct keyring_slot *s = &keyring->slots[slot];
+      uint64_t lease = __atomic_load_n (&s->lease, __ATOMIC_ACQUIRE);
+      uint64_t mine = 0;
+
+      if (KEYRING_READY == LEASE_STATE (lease))
+        {
+          if (0 == memcmp (s->fingerprint, fingerprint, sizeof (fingerprint)))
+            return checked_table (slot);
+          continue;
+        }
+
+      if ((mine = claim (s, lease)) == 0)
+        continue;
+
+      if (!p256_precompute (pub_key, &keyring->tables[slot]))
+        {
+          /* Give the slot back, an invalid key is never stored */
+          __atomic_compare_exchange_n (&s->lease, &mine, KEYRING_EMPTY, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+          return NULL;
+        }
+
+      memcpy (s->fingerprint, fingerprint, sizeof (fingerprint));
+      table_tag (fingerprint, &keyring->tables[slot], s->tag);
+
+      /* Only publish if the claim wasn't taken over meanwhile */
+      if (!__atomic_compare_exchange_n (&s->lease, &mine,
+                                        LEASE (KEYRING_READY, now ()), false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        return NULL;
+
+      return checked_table (slot);
+    }
+
+  return NULL;
+}
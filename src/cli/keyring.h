@@ -0,0 +1,73 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef KEYRING_H
+#define KEYRING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../crypto/p256.h"
+
+#define KEYRING_FILE "keyring"
+#define KEYRING_MAGIC "ECLET-KEYRING 2"
+
+/* The key tables are checked with, in the config directory rather
+   than the cache */
+#define KEYRING_KEY_FILE "keyring.key"
+#define KEYRING_KEY_LEN 32
+
+/* A slot claimed this long ago without being finished is taken to
+   have lost its writer.  Building a table takes milliseconds. */
+#define KEYRING_STALE_SECS 60
+
+/* Tables kept, the generator's included, about 1.7 MB on disk.  Once
+   full, further keys are verified without a table. */
+#define KEYRING_ENTRIES 32
+
+/**
+ * Use the keyring in this process from now on.  Offline verification
+ * with the p256 engine then looks up, or builds and stores, the fixed
+ * window tables of the public key and the generator.  Tables carry
+ * an HMAC under a per user key, so one written without the key is
+ * never used.
+ *
+ * @return false if the keyring or its key can't be used, verification
+ * still works
+ */
+bool keyring_open (void);
+
+void keyring_close (void);
+
+bool keyring_enabled (void);
+
+/**
+ * The table for a public key, built and stored on first use.  Stored
+ * tables are never changed, so the pointer stays valid until
+ * keyring_close.
+ *
+ * @param pub_key The uncompressed public key, P256_PUB_KEY_LEN bytes
+ *
+ * @return The table, or NULL if the keyring is closed or full, the
+ * key is not on the curve or its stored table fails its check
+ */
+const struct p256_table * keyring_table (const uint8_t *pub_key);
+
+#endif /* KEYRING_H */
@@ -45,11 +45,16 @@ static char doc[] =
   "an Atmel ATECC108\n\n"
   "Currently implemented Commands:\n\n"
   "personalize   --  You should run this command first upon receiving your\n"
-  "                  EClet.\n"
+  "                  EClet.  --profile uses a compiled profile's layout.\n"
+  "compile-profile\n"
+  "              --  Compiles the text profile in -f into the image named\n"
+  "                  by --profile, without the device.\n"
   "random        --  Retrieves 32 bytes of random data from the device.\n"
   "serial-num    --  Retrieves the device's serial number.\n"
   "get-config    --  Dumps the configuration zone\n"
   "get-otp       --  Dumps the OTP (one time programmable) zone\n"
+  "inventory     --  Serial number, state, config and OTP zones and every\n"
+  "                  slot's public key as one line of JSON.\n"
   "state         --  Returns the device's state.\n"
   "                  Factory -- Random will produced a fixed 0xFFFF0000\n"
   "                  Initialized -- Configuration is locked, keys may be \n"
@@ -62,14 +67,41 @@ static char doc[] =
   "                  Specify the file to signed with -f, which will be SHA-256\n"
   "                  hashed prior to signing. Specify the key with -k.\n"
   "                  Returns the signature (R,S)\n"
+  "                  --digest signs a precomputed SHA-256 digest instead.\n"
+  "                  With --batch, signs every file named in the list and\n"
+  "                  returns one path<TAB>signature line per file\n"
+  "                  --incremental resumes hashing an append only file\n"
+  "                  where the last run stopped\n"
   "verify        --  Uses the device to verify the signature.\n"
   "                  Specify the public key with --public-key, you must include\n"
   "                    the 0x04 tag followed by xy\n"
   "                  Specify the signature with --signature\n"
   "                  Specify the file with -f, it will be hashed with SHA256\n"
+  "                  or give its SHA256 digest with --digest\n"
+  "                  --stream verifies DIGEST SIGNATURE PUBLIC_KEY lines\n"
+  "                  from stdin until it closes\n"
+  "                  --engine auto uses whichever of the device and the\n"
+  "                  host is faster here, or both for a --digest-list\n"
+  "                  --stored-key checks against the key load-pub stored\n"
+  "                  in -k, instead of --public-key\n"
+  "load-pub      --  Stores --public-key in key slot -k (8 or above) for\n"
+  "                  verify --stored-key\n"
   "offline-verify-sign\n"
   "              --  Same as verify except it does NOT use the device, but a \n"
-  "                  software library.";
+  "                  software library.  --manifest verifies many\n"
+  "                  PATH SIGNATURE PUBLIC_KEY lines on every CPU.\n"
+  "                  --engine p256 uses the built in P-256 verifier.\n"
+  "sign-merkle   --  Signs the root of a SHA-256 Merkle tree over every file\n"
+  "                  in the --batch list and writes FILE.proof for each.\n"
+  "                  Returns the root signature (R,S)\n"
+  "offline-verify-merkle\n"
+  "              --  Verifies -f against its --proof and --public-key\n"
+  "                  without the device.\n"
+  "daemon        --  Keeps the device open and serves sign, verify, random\n"
+  "                  and get-pub requests on a Unix socket (--socket).\n"
+  "hash          --  SHA-256 of -f, stdin or every file in the --batch list,\n"
+  "                  on the host or with --engine device.  --stats reports\n"
+  "                  the throughput.";
 
 
 /* A description of the arguments we accept. */
@@ -78,6 +110,22 @@ static char args_doc[] = "command";
 #define OPT_UPDATE_SEED 300
 #define OPT_SIGNATURE 301
 #define OPT_PUB_KEY 302
+#define OPT_SOCKET 303
+#define OPT_BATCH 304
+#define OPT_PROOF 305
+#define OPT_DIGEST 306
+#define OPT_DIGEST_LIST 307
+#define OPT_ENGINE 308
+#define OPT_STATS 309
+#define OPT_INCREMENTAL 310
+#define OPT_DIGEST_CACHE 311
+#define OPT_MANIFEST 312
+#define OPT_KEYRING 313
+#define OPT_VERIFY_CACHE 314
+#define OPT_STREAM 315
+#define OPT_STORED_KEY 316
+#define OPT_PUB_KEY_CACHE 317
+#define OPT_PROFILE 318
 
 /* The options we understand. */
 static struct argp_option options[] = {
@@ -88,15 +136,61 @@ static struct argp_option options[] = {
   {"bus",      'b', "BUS",  0,  "I2C bus: defaults to /dev/i2c-1"},
   {"address",  'a', "ADDRESS",      0,  "i2c address for the device (in hex)"},
   {"file",     'f', "FILE",         0,  "Read from FILE vs. stdin"},
+  {"socket",   OPT_SOCKET, "SOCKET", 0,
+   "Unix socket for the daemon: defaults to $XDG_RUNTIME_DIR/eclet.sock, "
+   "or /tmp/eclet-UID/eclet.sock"},
   { 0, 0, 0, 0, "Sign and Verify Operations:", 1},
   {"signature", OPT_SIGNATURE, "SIGNATURE", 0, "The signature to be verified"},
   {"public-key", OPT_PUB_KEY, "PUBLIC_KEY", 0,
    "The public key that produced the signature"},
+  {"batch", OPT_BATCH, "LISTFILE", 0,
+   "Sign every file named in LISTFILE, one path per line"},
+  {"digest", OPT_DIGEST, "DIGEST", 0,
+   "The SHA256 digest of the data (64 bytes of ASCII Hex) instead of -f"},
+  {"digest-list", OPT_DIGEST_LIST, "FILE", 0,
+   "Sign DIGEST [NAME] lines, or verify DIGEST SIGNATURE lines against "
+   "--public-key"},
+  {"incremental", OPT_INCREMENTAL, 0, 0,
+   "Sign an append only -f file, hashing only what was appended since "
+   "the last run"},
+  {"manifest", OPT_MANIFEST, "FILE", 0,
+   "Verify PATH SIGNATURE PUBLIC_KEY lines offline on every CPU"},
+  {"stream", OPT_STREAM, 0, 0,
+   "Verify DIGEST SIGNATURE PUBLIC_KEY lines from stdin, answering each "
+   "with OK, FAIL or ERR"},
+  {"stored-key", OPT_STORED_KEY, 0, 0,
+   "Verify with the public key load-pub stored in -k SLOT, sending only "
+   "the signature"},
+  {"proof", OPT_PROOF, "PROOF", 0,
+   "The Merkle proof file written by sign-merkle"},
+  {"jobs", 'j', "JOBS", 0,
+   "Threads used to hash batch input: defaults to the number of CPUs"},
+  {"digest-cache", OPT_DIGEST_CACHE, 0, 0,
+   "Reuse digests of unchanged files from ~/.cache/eclet/digests"},
+  {"keyring", OPT_KEYRING, 0, 0,
+   "Verify offline with precomputed tables for each public key, kept in "
+   "~/.cache/eclet/keyring"},
+  {"verify-cache", OPT_VERIFY_CACHE, 0, 0,
+   "Remember signatures that verified in ~/.cache/eclet/verified, "
+   "protected by a key in ~/.config/eclet"},
+  { 0, 0, 0, 0, "Hash Options:", 5},
+  {"engine", OPT_ENGINE, "ENGINE", 0,
+   "host (default) or device, the device's SHA engine.  For offline "
+   "verification, host (default) or p256, the built in P-256 verifier.  "
+   "For verify, device (default) or auto, the faster of the device and "
+   "p256 as measured on this host"},
+  {"stats", OPT_STATS, 0, 0, "Print the hash throughput to stderr"},
+  { 0, 0, 0, 0, "Personalize Options:", 6},
+  {"profile", OPT_PROFILE, "PROFILE", 0,
+   "The compiled profile personalize applies, or compile-profile writes"},
   { 0, 0, 0, 0, "Random Command Options:", 2},
   {"update-seed", OPT_UPDATE_SEED, 0, 0,
      "Updates the random seed.  Only applicable to certain commands"},
   { 0, 0, 0, 0, "Key related command options:", 3},
   {"key-slot", 'k', "SLOT",      0,  "The internal key slot to use."},
+  {"pub-key-cache", OPT_PUB_KEY_CACHE, 0, 0,
+   "Answer get-pub from ~/.cache/eclet/pubkeys, by serial number and "
+   "slot, instead of running GenKey"},
   {"write", 'w', "WRITE",      0,
    "The 32 byte data to write to a slot (64 bytes of ASCII Hex)"},
   { 0, 0, 0, 0, "Check and Offline-Verify Mac Options:", 4},
@@ -118,6 +212,7 @@ parse_opt (int key, char *arg, struct argp_state *state)
      know is a pointer to our arguments structure. */
   struct arguments *arguments = state->input;
   int slot;
+  int jobs;
   long int address_arg;
 
   switch (key)
@@ -138,6 +233,67 @@ parse_opt (int key, char *arg, struct argp_state *state)
     case 'b':
       arguments->bus = arg;
       break;
+    case OPT_SOCKET:
+      arguments->socket = arg;
+      break;
+    case OPT_BATCH:
+      arguments->batch = arg;
+      break;
+    case OPT_DIGEST:
+      if (!is_hex_arg (arg, 64))
+        {
+          fprintf (stderr, "%s\n", "Invalid SHA256 Digest.");
+          argp_usage (state);
+        }
+      else
+        arguments->digest = arg;
+      break;
+    case OPT_DIGEST_LIST:
+      arguments->digest_list = arg;
+      break;
+    case OPT_PROOF:
+      arguments->proof = arg;
+      break;
+    case OPT_ENGINE:
+      arguments->engine = arg;
+      break;
+    case OPT_STATS:
+      arguments->stats = true;
+      break;
+    case OPT_INCREMENTAL:
+      arguments->incremental = true;
+      break;
+    case OPT_DIGEST_CACHE:
+      arguments->digest_cache = true;
+      break;
+    case OPT_MANIFEST:
+      arguments->manifest = arg;
+      break;
+    case OPT_KEYRING:
+      arguments->keyring = true;
+      break;
+    case OPT_VERIFY_CACHE:
+      arguments->verify_cache = true;
+      break;
+    case OPT_STREAM:
+      arguments->stream = true;
+      break;
+    case OPT_STORED_KEY:
+      arguments->stored_key = true;
+      break;
+    case OPT_PUB_KEY_CACHE:
+      arguments->pub_key_cache = true;
+      break;
+    case OPT_PROFILE:
+      arguments->profile = arg;
+      break;
+    case 'j':
+      jobs = atoi (arg);
+      if (jobs < 1)
+        argp_usage (state);
+
+      arguments->jobs = jobs;
+      break;
     case 'q': case 's':
       arguments->silent = 1;
       break;
@@ -177,7 +333,8 @@ parse_opt (int key, char *arg, struct argp_state *state)
       arguments->signature = arg;
       break;
     case OPT_PUB_KEY:
-      if (!is_hex_arg (arg, 130))
+      /* Only the uncompressed form, the 0x04 tag then X and Y */
+      if (!is_hex_arg (arg, 130) || 0 != strncmp (arg, "04", 2))
         {
           fprintf (stderr, "%s\n", "Invalid P256 Public Key.");
           argp_usage (state);
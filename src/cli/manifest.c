@@ -0,0 +1,288 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file   manifest.c
+ *
+ * @brief  Offline verification of many (file, signature, public key)
+ * entries on every core.
+ *
+ * Each manifest line is:
+ *
+ *   PATH SIGNATURE PUBLIC_KEY
+ *
+ * The signature and public key are the last two fields, so the path
+ * may contain spaces.
+ */
+
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+
+#include "batch.h"
+#include "file_digest.h"
+#include "manifest.h"
+#include "work_queue.h"
+#include "../crypto/sha256_mb.h"
+#include <libcryptoauth.h>
+
+enum manifest_result
+  {
+    MANIFEST_OK = 0,
+    MANIFEST_FAIL,                /**< Unreadable file or bad signature */
+    MANIFEST_INVALID              /**< The line could not be parsed */
+  };
+
+struct manifest_item
+{
+  unsigned long num;            /**< Line number */
+  char *line;
+  const char *path;             /**< Points into line */
+  const char *signature;
+  const char *pub_key;
+  enum manifest_result result;
+};
+
+struct manifest_source
+{
+  FILE *list;
+  char *line;
+  size_t n;
+  unsigned long num;
+  offline_verifier verify;      /**< Set before the workers start */
+};
+
+static void *
+next_item (void *ctx)
+{
+  struct manifest_source *src = ctx;
+  struct manifest_item *item = NULL;
+  const char *line = next_list_entry (src->list, &src->line, &src->n);
+
+  if (NULL == line)
+    return NULL;
+
+  item = lca_malloc_wipe (sizeof (*item));
+  item->num = ++src->num;
+  item->line = strdup (line);
+
+  return item;
+}
+
+/**
+ * Cut the last whitespace separated field off the end of line.
+ */
+static const char *
+last_field (char *line)
+{
+  char *end = line + strlen (line);
+  char *start = NULL;
+
+  while (end > line && (' ' == end[-1] || '\t' == end[-1]))
+    *--end = '\0';
+
+  for (start = end; start > line && ' ' != start[-1] && '\t' != start[-1];)
+    start--;
+
+  if (start == line)
+    return NULL;
+
+  start[-1] = '\0';
+
+  return start;
+}
+
+static bool
+parse_item (struct manifest_item *item)
+{
+  char *path = item->line;
+  char *end = NULL;
+
+  item->pub_key = last_field (item->line);
+  item->signature = NULL != item->pub_key ? last_field (item->line) : NULL;
+
+  if (NULL == item->signature || !is_hex_arg (item->pub_key, 130) ||
+      !is_hex_arg (item->signature, 128))
+    return false;
+
+  /* Trim the separators around the path */
+  while (' ' == *path || '\t' == *path)
+    path++;
+
+  for (end = path + strlen (path);
+       end > path && (' ' == end[-1] || '\t' == end[-1]);)
+    *--end = '\0';
+
+  item->path = path;
+
+  return '\0' != *path;
+}
+
+static bool
+verify_item (offline_verifier verify, const struct manifest_item *item,
+             struct lca_octet_buffer digest)
+{
+  struct lca_octet_buffer signature = lca_ascii_hex_2_bin (item->signature,
+                                                           128);
+  struct lca_octet_buffer pub_key = lca_ascii_hex_2_bin (item->pub_key, 130);
+  bool verified = verify (pub_key, signature, digest);
+
+  lca_free_octet_buffer (pub_key);
+  lca_free_octet_buffer (signature);
+
+  return verified;
+}
+
+static void *
+verify_worker (void *ctx)
+{
+  struct work_queue *q = ctx;
+  const struct manifest_source *src = q->ctx;
+  unsigned int lanes = sha256_mb_lanes ();
+  unsigned int max = lanes > 1 ? lanes * BATCH_FILES_PER_LANE : 1;
+  unsigned long seqs[SHA256_MB_MAX_LANES * BATCH_FILES_PER_LANE];
+  void *inputs[SHA256_MB_MAX_LANES * BATCH_FILES_PER_LANE];
+  const char *paths[SHA256_MB_MAX_LANES * BATCH_FILES_PER_LANE];
+  struct manifest_item *parsed[SHA256_MB_MAX_LANES * BATCH_FILES_PER_LANE];
+  struct lca_octet_buffer digests[SHA256_MB_MAX_LANES * BATCH_FILES_PER_LANE];
+  unsigned int num = 0;
+  unsigned int num_parsed = 0;
+  unsigned int x = 0;
+
+  while ((num = work_queue_claim_batch (q, max, seqs, inputs)) > 0)
+    {
+      num_parsed = 0;
+
+      for (x = 0; x < num; x++)
+        {
+          struct manifest_item *item = inputs[x];
+
+          if (parse_item (item))
+            {
+              paths[num_parsed] = item->path;
+              parsed[num_parsed++] = item;
+            }
+          else
+            item->result = MANIFEST_INVALID;
+        }
+
+      /* Hash the group together, then check each signature */
+      digest_paths (paths, num_parsed, digests);
+
+      for (x = 0; x < num_parsed; x++)
+        {
+          if (NULL != digests[x].ptr &&
+              verify_item (src->verify, parsed[x], digests[x]))
+            parsed[x]->result = MANIFEST_OK;
+          else
+            parsed[x]->result = MANIFEST_FAIL;
+
+          if (NULL != digests[x].ptr)
+            lca_free_octet_buffer (digests[x]);
+        }
+
+      for (x = 0; x < num; x++)
+        work_queue_publish (q, seqs[x], inputs[x]);
+    }
+
+  return NULL;
+}
+
+int
+verify_manifest (struct arguments *args)
+{
+  int result = HASHLET_COMMAND_SUCCESS;
+  struct manifest_source src = { NULL, NULL, 0, 0, NULL };
+  struct work_queue *q = NULL;
+  pthread_t *workers = NULL;
+  unsigned long counts[3] = { 0, 0, 0 };
+  unsigned int jobs = 0;
+  unsigned int x = 0;
+  struct timespec start, end;
+  double secs = 0;
+  void *taken = NULL;
+
+  assert (NULL != args);
+  assert (NULL != args->manifest);
+
+  if ((src.verify = offline_engine (args)) == NULL)
+    return HASHLET_COMMAND_FAIL;
+
+  if ((src.list = fopen (args->manifest, "r")) == NULL)
+    {
+      perror ("Failed to open manifest");
+      return HASHLET_COMMAND_FAIL;
+    }
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+
+  jobs = args->jobs > 0 ? args->jobs : default_jobs ();
+  q = work_queue_new (MANIFEST_QUEUE_DEPTH_PER_JOB * jobs, next_item, &src);
+  workers = lca_malloc_wipe (jobs * sizeof (pthread_t));
+
+  for (x = 0; x < jobs; x++)
+    if (0 != pthread_create (&workers[x], NULL, verify_worker, q))
+      break;
+
+  if (0 == (jobs = x))
+    {
+      fprintf (stderr, "%s\n", "Failed to start verify threads");
+      result = HASHLET_COMMAND_FAIL;
+      q->drained = true;
+    }
+
+  while (work_queue_take (q, &taken))
+    {
+      struct manifest_item *item = taken;
+
+      counts[item->result]++;
+
+      if (MANIFEST_INVALID == item->result)
+        fprintf (stderr, "%s:%lu: %s\n", args->manifest, item->num,
+                 "Expected PATH SIGNATURE PUBLIC_KEY");
+      else
+        fprintf (stdout, "%s\t%s\n", item->path,
+                 MANIFEST_OK == item->result ? "OK" : "FAIL");
+
+      if (MANIFEST_OK != item->result)
+        result = HASHLET_COMMAND_FAIL;
+
+      free (item->line);
+      free (item);
+    }
+
+  for (x = 0; x < jobs; x++)
+    pthread_join (workers[x], NULL);
+
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+  fprintf (stderr, "%lu verified, %lu failed, %lu invalid in %.3f s: "
+           "%.1f entries/s on %u threads\n", counts[MANIFEST_OK],
+           counts[MANIFEST_FAIL], counts[MANIFEST_INVALID], secs,
+           secs > 0 ? (counts[0] + counts[1] + counts[2]) / secs : 0, jobs);
+
+  free (workers);
+  work_queue_free (q);
+  free (src.line);
+  fclose (src.list);
+
+  return result;
+}
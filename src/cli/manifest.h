@@ -0,0 +1,43 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include "cli_commands.h"
+
+/* Manifest entries each worker thread may have in flight */
+#define MANIFEST_QUEUE_DEPTH_PER_JOB 64
+
+/**
+ * Verify every PATH SIGNATURE PUBLIC_KEY line of the manifest in
+ * software.  Worker threads, one per CPU unless jobs says otherwise,
+ * hash the files and check the signatures.  One PATH<TAB>OK or
+ * PATH<TAB>FAIL line is written per entry, in manifest order, and a
+ * summary with the throughput goes to stderr.
+ *
+ * @param args The arguments, manifest names the manifest file
+ *
+ * @return Success if every signature verified
+ */
+int
+verify_manifest (struct arguments *args);
+
+#endif /* MANIFEST_H */
@@ -0,0 +1,481 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file   merkle.c
+ *
+ * @brief  Signs a batch of files with one device signature over the
+ * root of a Merkle tree, and verifies single files against it.
+ *
+ * Each file gets a proof file next to it:
+ *
+ *   ECLET-MERKLE 2
+ *   leaf INDEX COUNT
+ *   root ROOT
+ *   signature SIGNATURE
+ *   L|R SIBLING
+ *   ...
+ *
+ * The sibling lines run from the leaf up to the root.  L means the
+ * sibling is the left child.  The signature covers
+ * merkle_signed_digest of the root, not the bare root.
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "cli_commands.h"
+#include "batch.h"
+#include "merkle.h"
+#include "../crypto/sha256.h"
+#include <libcryptoauth.h>
+
+static void
+hash_prefixed (uint8_t prefix, const uint8_t *a, const uint8_t *b,
+               uint8_t *out)
+{
+  struct sha256_ctx ctx;
+
+  sha256_init (&ctx);
+  sha256_update (&ctx, &prefix, 1);
+  sha256_update (&ctx, a, MERKLE_HASH_LEN);
+
+  if (NULL != b)
+    sha256_update (&ctx, b, MERKLE_HASH_LEN);
+
+  sha256_final (&ctx, out);
+}
+
+void
+merkle_leaf (const uint8_t *digest, uint8_t *leaf)
+{
+  hash_prefixed (MERKLE_LEAF_PREFIX, digest, NULL, leaf);
+}
+
+void
+merkle_node (const uint8_t *left, const uint8_t *right, uint8_t *parent)
+{
+  hash_prefixed (MERKLE_NODE_PREFIX, left, right, parent);
+}
+
+bool
+merkle_build (uint8_t (*leaves)[MERKLE_HASH_LEN], unsigned long num_leaves,
+              struct merkle_tree *tree)
+{
+  unsigned long count = num_leaves;
+  unsigned long level = 0;
+  unsigned long next = 0;
+  unsigned long x = 0;
+
+  assert (NULL != leaves);
+  assert (NULL != tree);
+
+  if (0 == num_leaves)
+    return false;
+
+  /* Promoted nodes are stored again on the next level, so count
+     every level rather than assume a full binary tree */
+  for (count = num_leaves; count > 1; count = (count + 1) / 2)
+    next += count;
+  next++;
+
+  tree->num_leaves = num_leaves;
+  tree->num_nodes = 0;
+  tree->nodes = malloc (next * MERKLE_HASH_LEN);
+
+  if (NULL == tree->nodes)
+    return false;
+
+  memcpy (tree->nodes, leaves, num_leaves * MERKLE_HASH_LEN);
+  count = num_leaves;
+  next = num_leaves;
+
+  while (count > 1)
+    {
+      for (x = 0; x + 1 < count; x += 2)
+        merkle_node (tree->nodes[level + x], tree->nodes[level + x + 1],
+                     tree->nodes[next++]);
+
+      if (x < count)
+        memcpy (tree->nodes[next++], tree->nodes[level + x], MERKLE_HASH_LEN);
+
+      level += count;
+      count = (count + 1) / 2;
+    }
+
+  tree->num_nodes = next;
+
+  return true;
+}
+
+void
+merkle_signed_digest (unsigned long num_leaves, const uint8_t *root,
+                      uint8_t *digest)
+{
+  struct sha256_ctx ctx;
+  uint8_t count[8];
+  int x = 0;
+
+  for (x = 7; x >= 0; x--, num_leaves >>= 8)
+    count[x] = num_leaves & 0xFF;
+
+  sha256_init (&ctx);
+  sha256_update (&ctx, MERKLE_PROOF_MAGIC, sizeof (MERKLE_PROOF_MAGIC));
+  sha256_update (&ctx, count, sizeof (count));
+  sha256_update (&ctx, root, MERKLE_HASH_LEN);
+  sha256_final (&ctx, digest);
+}
+
+const uint8_t *
+merkle_root (const struct merkle_tree *tree)
+{
+  assert (NULL != tree);
+  assert (tree->num_nodes > 0);
+
+  return tree->nodes[tree->num_nodes - 1];
+}
+
+void
+merkle_free (struct merkle_tree *tree)
+{
+  assert (NULL != tree);
+
+  free (tree->nodes);
+  tree->nodes = NULL;
+  tree->num_nodes = 0;
+}
+
+static void
+fprint_hex (FILE *f, const uint8_t *p, unsigned int len)
+{
+  unsigned int x = 0;
+
+  for (x = 0; x < len; x++)
+    fprintf (f, "%02X", p[x]);
+}
+
+static bool
+write_proof (const char *path, const struct merkle_tree *tree,
+             unsigned long index, struct lca_octet_buffer signature)
+{
+  size_t len = strlen (path) + strlen (MERKLE_PROOF_SUFFIX) + 1;
+  char *proof_path = malloc (len);
+  unsigned long level = 0;
+  unsigned long count = tree->num_leaves;
+  FILE *f = NULL;
+  bool result = false;
+
+  snprintf (proof_path, len, "%s%s", path, MERKLE_PROOF_SUFFIX);
+
+  if ((f = fopen (proof_path, "w")) == NULL)
+    {
+      perror (proof_path);
+      free (proof_path);
+      return false;
+    }
+
+  fprintf (f, "%s\nleaf %lu %lu\nroot ", MERKLE_PROOF_MAGIC, index,
+           tree->num_leaves);
+  fprint_hex (f, merkle_root (tree), MERKLE_HASH_LEN);
+  fprintf (f, "\nsignature ");
+  fprint_hex (f, signature.ptr, signature.len);
+  fprintf (f, "\n");
+
+  while (count > 1)
+    {
+      unsigned long sibling = index ^ 1;
+
+      if (sibling < count)
+        {
+          fprintf (f, "%c ", index & 1 ? 'L' : 'R');
+          fprint_hex (f, tree->nodes[level + sibling], MERKLE_HASH_LEN);
+          fprintf (f, "\n");
+        }
+
+      level += count;
+      index /= 2;
+      count = (count + 1) / 2;
+    }
+
+  if (0 == fclose (f))
+    result = true;
+  else
+    perror (proof_path);
+
+  free (proof_path);
+
+  return result;
+}
+
+struct leaf_list
+{
+  unsigned long len;
+  unsigned long cap;
+  char **paths;
+  uint8_t (*leaves)[MERKLE_HASH_LEN];
+};
+
+static bool
+collect_leaf (const char *path, struct lca_octet_buffer digest, void *ctx)
+{
+  struct leaf_list *list = ctx;
+
+  if (NULL == digest.ptr)
+    return false;
+
+  if (list->len == list->cap)
+    {
+      list->cap = list->cap > 0 ? 2 * list->cap : 64;
+      list->paths = realloc (list->paths, list->cap * sizeof (char *));
+      list->leaves = realloc (list->leaves, list->cap * MERKLE_HASH_LEN);
+      assert (NULL != list->paths && NULL != list->leaves);
+    }
+
+  list->paths[list->len] = strdup (path);
+  merkle_leaf (digest.ptr, list->leaves[list->len]);
+  list->len++;
+
+  return true;
+}
+
+int
+cli_sign_merkle (int fd, struct arguments *args)
+{
+  int result = HASHLET_COMMAND_FAIL;
+  struct leaf_list list = { 0, 0, NULL, NULL };
+  struct merkle_tree tree = { 0, 0, NULL };
+  unsigned long x = 0;
+
+  assert (NULL != args);
+
+  if (NULL == args->batch)
+    {
+      fprintf (stderr, "%s\n", "A batch list is required");
+      return result;
+    }
+
+  if (!digest_list (args->batch, args->jobs, collect_leaf, &list))
+    fprintf (stderr, "%s\n", "Not every file could be hashed, nothing signed");
+  else if (!merkle_build (list.leaves, list.len, &tree))
+    fprintf (stderr, "%s\n", "Failed to build the Merkle tree");
+  else
+    {
+      uint8_t signed_digest[MERKLE_HASH_LEN];
+      struct lca_octet_buffer digest = { signed_digest,
+                                         sizeof (signed_digest) };
+
+      lca_print_hex_string ("Merkle root", merkle_root (&tree),
+                            MERKLE_HASH_LEN);
+      merkle_signed_digest (list.len, merkle_root (&tree), signed_digest);
+
+      /* Forces a seed update on the RNG */
+      struct lca_octet_buffer r = lca_get_random (fd, true);
+      struct lca_octet_buffer rsp = sign_digest (fd, args->key_slot, digest);
+
+      if (NULL != rsp.ptr)
+        {
+          result = HASHLET_COMMAND_SUCCESS;
+
+          for (x = 0; x < list.len; x++)
+            if (!write_proof (list.paths[x], &tree, x, rsp))
+              result = HASHLET_COMMAND_FAIL;
+
+          output_hex (stdout, rsp);
+          lca_free_octet_buffer (rsp);
+        }
+      else
+        fprintf (stderr, "%s\n", "Sign Command failed.");
+
+      lca_free_octet_buffer (r);
+      merkle_free (&tree);
+    }
+
+  for (x = 0; x < list.len; x++)
+    free (list.paths[x]);
+
+  free (list.paths);
+  free (list.leaves);
+
+  return result;
+}
+
+static bool
+read_proof_line (FILE *proof, char *line, int size)
+{
+  if (NULL == fgets (line, size, proof))
+    return false;
+
+  line[strcspn (line, "\r\n")] = '\0';
+
+  return true;
+}
+
+/**
+ * Read "key HEX" from a proof line into out.
+ */
+static bool
+parse_hex_field (const char *line, const char *key, unsigned int hex_len,
+                 uint8_t *out)
+{
+  size_t key_len = strlen (key);
+  const char *hex = line + key_len + 1;
+  struct lca_octet_buffer bin;
+
+  if (0 != strncmp (line, key, key_len) || ' ' != line[key_len] ||
+      !is_hex_arg (hex, hex_len))
+    return false;
+
+  bin = lca_ascii_hex_2_bin (hex, hex_len);
+  memcpy (out, bin.ptr, hex_len / 2);
+  lca_free_octet_buffer (bin);
+
+  return true;
+}
+
+/**
+ * Fold the proof's sibling path over the leaf and check that it
+ * reaches the recorded root.  The sides must be the ones the index
+ * and leaf count call for.  On success, signed_digest is what the
+ * signature must cover.
+ */
+static bool
+check_proof (FILE *proof, const uint8_t *leaf, uint8_t *signed_digest,
+             uint8_t *signature)
+{
+  char line[256];
+  uint8_t hash[MERKLE_HASH_LEN];
+  uint8_t root[MERKLE_HASH_LEN];
+  uint8_t sibling[MERKLE_HASH_LEN];
+  unsigned long index = 0;
+  unsigned long count = 0;
+  unsigned long num_leaves = 0;
+
+  if (!read_proof_line (proof, line, sizeof (line)) ||
+      0 != strcmp (line, MERKLE_PROOF_MAGIC))
+    return false;
+
+  if (!read_proof_line (proof, line, sizeof (line)) ||
+      2 != sscanf (line, "leaf %lu %lu", &index, &count) || index >= count)
+    return false;
+
+  num_leaves = count;
+
+  if (!read_proof_line (proof, line, sizeof (line)) ||
+      !parse_hex_field (line, "root", 2 * MERKLE_HASH_LEN, root))
+    return false;
+
+  if (!read_proof_line (proof, line, sizeof (line)) ||
+      !parse_hex_field (line, "signature", 128, signature))
+    return false;
+
+  memcpy (hash, leaf, MERKLE_HASH_LEN);
+
+  while (count > 1)
+    {
+      if ((index ^ 1) < count)
+        {
+          const char *side = index & 1 ? "L" : "R";
+
+          if (!read_proof_line (proof, line, sizeof (line)) ||
+              !parse_hex_field (line, side, 2 * MERKLE_HASH_LEN, sibling))
+            return false;
+
+          if (index & 1)
+            merkle_node (sibling, hash, hash);
+          else
+            merkle_node (hash, sibling, hash);
+        }
+
+      index /= 2;
+      count = (count + 1) / 2;
+    }
+
+  if (0 != memcmp (hash, root, MERKLE_HASH_LEN))
+    return false;
+
+  merkle_signed_digest (num_leaves, root, signed_digest);
+
+  return true;
+}
+
+int
+cli_offline_verify_merkle (int fd, struct arguments *args)
+{
+  int result = HASHLET_COMMAND_FAIL;
+  FILE *proof = NULL;
+  uint8_t leaf[MERKLE_HASH_LEN];
+  uint8_t signed_digest[MERKLE_HASH_LEN];
+  uint8_t sig[64];
+  offline_verifier verify = NULL;
+
+  assert (NULL != args);
+
+  if ((verify = offline_engine (args)) == NULL)
+    {
+      return result;
+    }
+  else if (NULL == args->pub_key)
+    {
+      fprintf (stderr, "%s\n", "Public Key required");
+    }
+  else if (NULL == args->proof)
+    {
+      fprintf (stderr, "%s\n", "Proof file required");
+    }
+  else if ((proof = fopen (args->proof, "r")) == NULL)
+    {
+      perror (args->proof);
+    }
+  else
+    {
+      struct lca_octet_buffer file_digest = input_digest (args);
+
+      if (NULL != file_digest.ptr)
+        {
+          merkle_leaf (file_digest.ptr, leaf);
+
+          if (!check_proof (proof, leaf, signed_digest, sig))
+            {
+              fprintf (stderr, "%s\n", "Proof does not match the file");
+            }
+          else
+            {
+              struct lca_octet_buffer pub_key =
+                lca_ascii_hex_2_bin (args->pub_key, 130);
+              struct lca_octet_buffer signature = { sig, sizeof (sig) };
+              struct lca_octet_buffer digest = { signed_digest,
+                                                 sizeof (signed_digest) };
+
+              if (verify (pub_key, signature, digest))
+                result = HASHLET_COMMAND_SUCCESS;
+              else
+                fprintf (stderr, "%s\n", "Verify Failed");
+
+              lca_free_octet_buffer (pub_key);
+            }
+
+          lca_free_octet_buffer (file_digest);
+        }
+
+      fclose (proof);
+    }
+
+  return result;
+}
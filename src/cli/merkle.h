@@ -0,0 +1,101 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MERKLE_H
+#define MERKLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MERKLE_HASH_LEN 32
+
+/* Domain separation prefixes, so a leaf can never be passed off as an
+   interior node or the other way around */
+#define MERKLE_LEAF_PREFIX 0x00
+#define MERKLE_NODE_PREFIX 0x01
+
+#define MERKLE_PROOF_MAGIC "ECLET-MERKLE 2"
+#define MERKLE_PROOF_SUFFIX ".proof"
+
+/* A SHA256 Merkle tree.  Each level is stored after the one below
+   it, leaves first.  An odd node at the end of a level is promoted to
+   the next level unchanged. */
+struct merkle_tree
+{
+  unsigned long num_leaves;
+  unsigned long num_nodes;
+  uint8_t (*nodes)[MERKLE_HASH_LEN];
+};
+
+/**
+ * Hash a file digest into a leaf.
+ *
+ * @param digest The 32 byte SHA256 digest of the item
+ * @param leaf Filled with the 32 byte leaf hash
+ */
+void merkle_leaf (const uint8_t *digest, uint8_t *leaf);
+
+/**
+ * Hash two children into their parent.
+ *
+ * @param left The left child
+ * @param right The right child
+ * @param parent Filled with the 32 byte parent hash
+ */
+void merkle_node (const uint8_t *left, const uint8_t *right, uint8_t *parent);
+
+/**
+ * Build the tree over the leaves.
+ *
+ * @param leaves The leaf hashes
+ * @param num_leaves The number of leaves, at least one
+ * @param tree The tree to fill in, free with merkle_free
+ *
+ * @return true on success
+ */
+bool merkle_build (uint8_t (*leaves)[MERKLE_HASH_LEN],
+                   unsigned long num_leaves, struct merkle_tree *tree);
+
+/**
+ * The root of a built tree.
+ *
+ * @param tree The tree
+ *
+ * @return A pointer to the 32 byte root, owned by the tree
+ */
+const uint8_t * merkle_root (const struct merkle_tree *tree);
+
+/**
+ * The digest the device signs for a tree.  The root is tagged with
+ * the proof magic, its terminating NUL and the leaf count as 8 big
+ * endian bytes, so a root signature is not also a signature over a
+ * file that happens to be 0x01 || left || right, nor the other way
+ * around.
+ *
+ * @param num_leaves The number of leaves
+ * @param root The 32 byte root
+ * @param digest Filled with the 32 byte digest to sign
+ */
+void merkle_signed_digest (unsigned long num_leaves, const uint8_t *root,
+                           uint8_t *digest);
+
+void merkle_free (struct merkle_tree *tree);
+
+#endif /* MERKLE_H */
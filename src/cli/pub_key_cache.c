@@ -0,0 +1,203 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file   pub_key_cache.c
+ *
+ * @brief  Remembers the public key of each slot, by device serial
+ * number, so get-pub doesn't need a GenKey.
+ *
+ * A slot's key only changes when GenKey runs on it, and gen-key drops
+ * the slot's line first.  The serial number is still read from the
+ * device, so a board swapped on the same bus never gets another
+ * board's key.
+ *
+ * What get-pub prints is what users pin as a verify key, so each line
+ * carries an HMAC of its serial number, slot and key under a per user
+ * key, as the verify cache does.  A line that fails it is a miss.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pub_key_cache.h"
+#include "cache_file.h"
+#include "cli_commands.h"
+#include "../crypto/sha256.h"
+
+static bool cache_enabled = false;
+static uint8_t cache_secret[PUB_KEY_CACHE_KEY_LEN];
+
+/* The serial number in hex, read once per process */
+static char serial_hex[2 * 16 + 1];
+
+bool
+pub_key_cache_open (void)
+{
+  char *path = cache_file_path (PUB_KEY_CACHE_FILE);
+
+  cache_enabled = NULL != path &&
+    config_secret (PUB_KEY_CACHE_KEY_FILE, cache_secret,
+                   sizeof (cache_secret));
+  free (path);
+
+  return cache_enabled;
+}
+
+void
+pub_key_cache_close (void)
+{
+  cache_enabled = false;
+  memset (cache_secret, 0, sizeof (cache_secret));
+}
+
+bool
+pub_key_cache_enabled (void)
+{
+  return cache_enabled;
+}
+
+/**
+ * The "SERIAL SLOT" a line starts with.
+ *
+ * @return false if the serial number can't be read
+ */
+static bool
+cache_key (int fd, unsigned int slot, char *key, size_t len)
+{
+  unsigned int x = 0;
+
+  if ('\0' == serial_hex[0])
+    {
+      struct lca_octet_buffer serial = get_serial_num (fd);
+
+      if (NULL == serial.ptr)
+        return false;
+
+      for (x = 0; x < serial.len && 2 * x + 2 < sizeof (serial_hex); x++)
+        snprintf (serial_hex + 2 * x, 3, "%02X", serial.ptr[x]);
+
+      lca_free_octet_buffer (serial);
+    }
+
+  snprintf (key, len, "%s %u", serial_hex, slot);
+
+  return true;
+}
+
+/**
+ * The line's value, the key in hex then the MAC of "SERIAL SLOT KEY"
+ * in hex.
+ *
+ * @param value Filled with PUB_KEY_CACHE_VALUE_LEN characters
+ */
+static void
+cache_value (const char *key, const char *pub_hex, char *value)
+{
+  char line[64 + 1 + 130 + 1];
+  uint8_t mac[SHA256_DIGEST_LEN];
+  unsigned int x = 0;
+
+  snprintf (line, sizeof (line), "%s %s", key, pub_hex);
+  hmac_sha256 (cache_secret, sizeof (cache_secret), line, strlen (line),
+               mac);
+
+  snprintf (value, PUB_KEY_CACHE_VALUE_LEN + 1, "%s ", pub_hex);
+  for (x = 0; x < sizeof (mac); x++)
+    snprintf (value + 131 + 2 * x, 3, "%02X", mac[x]);
+}
+
+struct lca_octet_buffer
+pub_key_cache_lookup (int fd, unsigned int slot)
+{
+  struct lca_octet_buffer pub_key = {0,0};
+  char expected[PUB_KEY_CACHE_VALUE_LEN + 1];
+  char pub_hex[130 + 1];
+  char key[64];
+  char *value = NULL;
+
+  if (!cache_enabled || !cache_key (fd, slot, key, sizeof (key)))
+    return pub_key;
+
+  if ((value = cache_file_lookup (PUB_KEY_CACHE_FILE, key)) != NULL)
+    {
+      if (PUB_KEY_CACHE_VALUE_LEN == strlen (value) && ' ' == value[130])
+        {
+          memcpy (pub_hex, value, 130);
+          pub_hex[130] = '\0';
+
+          if (is_hex_arg (pub_hex, 130))
+            {
+              cache_value (key, pub_hex, expected);
+
+              if (0 == strcmp (value, expected))
+                pub_key = lca_ascii_hex_2_bin (pub_hex, 130);
+              else
+                LCA_LOG (DEBUG, "Cached key for slot %u failed its check",
+                         slot);
+            }
+        }
+
+      free (value);
+    }
+
+  return pub_key;
+}
+
+void
+pub_key_cache_store (int fd, unsigned int slot,
+                     struct lca_octet_buffer pub_key)
+{
+  char key[64];
+  char pub_hex[2 * 65 + 1];
+  char value[PUB_KEY_CACHE_VALUE_LEN + 1];
+  unsigned int x = 0;
+
+  assert (NULL != pub_key.ptr);
+
+  if (!cache_enabled || 65 != pub_key.len ||
+      !cache_key (fd, slot, key, sizeof (key)))
+    return;
+
+  for (x = 0; x < pub_key.len; x++)
+    snprintf (pub_hex + 2 * x, 3, "%02X", pub_key.ptr[x]);
+
+  cache_value (key, pub_hex, value);
+  cache_file_replace (PUB_KEY_CACHE_FILE, key, value);
+}
+
+void
+pub_key_cache_forget (int fd, unsigned int slot)
+{
+  char key[64];
+  char *value = NULL;
+
+  if (!cache_key (fd, slot, key, sizeof (key)))
+    return;
+
+  /* Only rewrite the file when there is something to drop */
+  if ((value = cache_file_lookup (PUB_KEY_CACHE_FILE, key)) != NULL)
+    {
+      cache_file_replace (PUB_KEY_CACHE_FILE, key, NULL);
+      free (value);
+    }
+}
@@ -0,0 +1,82 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PUB_KEY_CACHE_H
+#define PUB_KEY_CACHE_H
+
+#include <stdbool.h>
+#include <libcryptoauth.h>
+
+/* Text lines of SERIAL SLOT PUBLIC_KEY MAC, in hex */
+#define PUB_KEY_CACHE_FILE "pubkeys"
+
+/* The HMAC key, in the config directory rather than the cache */
+#define PUB_KEY_CACHE_KEY_FILE "pub-key-cache.key"
+#define PUB_KEY_CACHE_KEY_LEN 32
+
+/* PUBLIC_KEY MAC */
+#define PUB_KEY_CACHE_VALUE_LEN (130 + 1 + 64)
+
+/**
+ * Use the public key cache in this process from now on, so get-pub
+ * answers from the cache instead of running GenKey.
+ *
+ * @return false if the cache directory or its key can't be used
+ */
+bool pub_key_cache_open (void);
+
+void pub_key_cache_close (void);
+
+bool pub_key_cache_enabled (void);
+
+/**
+ * The cached public key of a slot on this device.
+ *
+ * @param fd The open device, whose serial number is read once per
+ * process
+ * @param slot The key slot
+ *
+ * @return The 65 byte uncompressed key, which must be freed, or a NULL
+ * buffer on a miss, when the line fails its MAC or when the cache
+ * isn't open
+ */
+struct lca_octet_buffer pub_key_cache_lookup (int fd, unsigned int slot);
+
+/**
+ * Remember a slot's public key, when the cache is open.
+ *
+ * @param fd The open device
+ * @param slot The key slot
+ * @param pub_key The 65 byte uncompressed key
+ */
+void pub_key_cache_store (int fd, unsigned int slot,
+                          struct lca_octet_buffer pub_key);
+
+/**
+ * Drop a slot's public key before GenKey replaces it.  This is done
+ * whether or not the cache is open, so a later get-pub with the cache
+ * can't return the old key.
+ *
+ * @param fd The open device
+ * @param slot The key slot
+ */
+void pub_key_cache_forget (int fd, unsigned int slot);
+
+#endif /* PUB_KEY_CACHE_H */
@@ -0,0 +1,185 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file   verify_cache.c
+ *
+ * @brief  A persistent, memory mapped cache of verified signatures.
+ *
+ * An entry is just the HMAC-SHA256 tag of the tuple and when it was
+ * last used.  The tag both finds the entry and proves it: without the
+ * key no one can produce the tag of a tuple, and an entry torn by a
+ * concurrent writer matches no tuple at all.  So, as in the digest
+ * cache, several processes and threads share the table without
+ * locks.
+ */
+
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+
+#include "cache_file.h"
+#include "verify_cache.h"
+#include "../crypto/sha256.h"
+
+#define TUPLE_LEN (65 + 32 + 64)
+
+struct verify_cache_entry
+{
+  uint8_t tag[SHA256_DIGEST_LEN];
+  int64_t used;                 /**< Seconds, for eviction */
+  uint8_t reserved[8];
+};
+
+struct verify_cache
+{
+  struct cache_header header;
+  struct verify_cache_entry entries[VERIFY_CACHE_ENTRIES];
+};
+
+static struct verify_cache *cache = NULL;
+static uint8_t cache_key[VERIFY_CACHE_KEY_LEN];
+
+bool
+verify_cache_open (void)
+{
+  if (NULL != cache)
+    return true;
+
+  if (!config_secret (VERIFY_CACHE_KEY_FILE, cache_key, sizeof (cache_key)))
+    return false;
+
+  cache = cache_file_map (VERIFY_CACHE_FILE, VERIFY_CACHE_MAGIC,
+                          sizeof (struct verify_cache));
+
+  return NULL != cache;
+}
+
+void
+verify_cache_close (void)
+{
+  cache_file_unmap (cache, sizeof (struct verify_cache));
+  cache = NULL;
+  memset (cache_key, 0, sizeof (cache_key));
+}
+
+bool
+verify_cache_enabled (void)
+{
+  return NULL != cache;
+}
+
+static unsigned int
+tuple_tag (const uint8_t *pub_key, const uint8_t *digest,
+           const uint8_t *signature, uint8_t *tag)
+{
+  uint8_t tuple[TUPLE_LEN];
+
+  memcpy (tuple, pub_key, 65);
+  memcpy (tuple + 65, digest, 32);
+  memcpy (tuple + 65 + 32, signature, 64);
+
+  hmac_sha256 (cache_key, sizeof (cache_key), tuple, sizeof (tuple), tag);
+
+  /* The tag is uniform, so its first bytes pick the home slot */
+  return (tag[0] | tag[1] << 8 | tag[2] << 16) & (VERIFY_CACHE_ENTRIES - 1);
+}
+
+static int64_t
+now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_REALTIME, &ts);
+
+  return ts.tv_sec;
+}
+
+bool
+verify_cache_lookup (const uint8_t *pub_key, const uint8_t *digest,
+                     const uint8_t *signature)
+{
+  uint8_t tag[SHA256_DIGEST_LEN];
+  unsigned int slot = 0;
+  unsigned int x = 0;
+
+  assert (NULL != pub_key);
+  assert (NULL != digest);
+  assert (NULL != signature);
+
+  if (NULL == cache)
+    return false;
+
+  slot = tuple_tag (pub_key, digest, signature, tag);
+
+  for (x = 0; x < VERIFY_CACHE_PROBES; x++)
+    {
+      struct verify_cache_entry *e =
+        &cache->entries[(slot + x) & (VERIFY_CACHE_ENTRIES - 1)];
+
+      if (0 == memcmp (e->tag, tag, sizeof (tag)))
+        {
+          e->used = now ();
+          return true;
+        }
+    }
+
+  return false;
+}
+
+void
+verify_cache_store (const uint8_t *pub_key, const uint8_t *digest,
+                    const uint8_t *signature)
+{
+  struct verify_cache_entry e;
+  unsigned int slot = 0;
+  unsigned int target = 0;
+  unsigned int x = 0;
+
+  assert (NULL != pub_key);
+  assert (NULL != digest);
+  assert (NULL != signature);
+
+  if (NULL == cache)
+    return;
+
+  memset (&e, 0, sizeof (e));
+  slot = tuple_tag (pub_key, digest, signature, e.tag);
+  e.used = now ();
+
+  /* Evict the least recently used probe, empty ones are oldest */
+  target = slot;
+
+  for (x = 0; x < VERIFY_CACHE_PROBES; x++)
+    {
+      unsigned int i = (slot + x) & (VERIFY_CACHE_ENTRIES - 1);
+
+      if (0 == memcmp (cache->entries[i].tag, e.tag, sizeof (e.tag)))
+        {
+          target = i;
+          break;
+        }
+
+      if (cache->entries[i].used < cache->entries[target].used)
+        target = i;
+    }
+
+  memcpy (&cache->entries[target], &e, sizeof (e));
+}
@@ -0,0 +1,79 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef VERIFY_CACHE_H
+#define VERIFY_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define VERIFY_CACHE_FILE "verified"
+#define VERIFY_CACHE_MAGIC "ECLET-VERIFIED 1"
+
+/* The HMAC key, in the config directory rather than the cache */
+#define VERIFY_CACHE_KEY_FILE "verify-cache.key"
+#define VERIFY_CACHE_KEY_LEN 32
+
+/* Power of two, 3 MB on disk */
+#define VERIFY_CACHE_ENTRIES 65536
+
+/* Slots searched from a tuple's home slot, the least recently used of
+   them is evicted when all are taken */
+#define VERIFY_CACHE_PROBES 8
+
+/**
+ * Use the verification cache in this process from now on.  Signatures
+ * that verified are remembered by an HMAC of (public key, digest,
+ * signature) under a per user key, so a cache copied from elsewhere
+ * or written by anyone without the key is worthless rather than
+ * trusted.
+ *
+ * @return false if the cache or its key can't be used, verification
+ * still works
+ */
+bool verify_cache_open (void);
+
+void verify_cache_close (void);
+
+bool verify_cache_enabled (void);
+
+/**
+ * Whether this signature verified before.
+ *
+ * @param pub_key The 65 byte uncompressed public key
+ * @param digest The 32 byte digest
+ * @param signature The 64 byte signature
+ *
+ * @return true on a hit
+ */
+bool verify_cache_lookup (const uint8_t *pub_key, const uint8_t *digest,
+                          const uint8_t *signature);
+
+/**
+ * Remember a signature that verified.  Only successes are stored.
+ *
+ * @param pub_key The 65 byte uncompressed public key
+ * @param digest The 32 byte digest
+ * @param signature The 64 byte signature
+ */
+void verify_cache_store (const uint8_t *pub_key, const uint8_t *digest,
+                         const uint8_t *signature);
+
+#endif /* VERIFY_CACHE_H */
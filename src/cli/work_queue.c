@@ -0,0 +1,158 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "work_queue.h"
+#include <libcryptoauth.h>
+
+struct work_queue *
+work_queue_new (unsigned int depth, work_source source, void *ctx)
+{
+  assert (depth > 0);
+  assert (NULL != source);
+
+  struct work_queue *q = lca_malloc_wipe (sizeof (struct work_queue));
+
+  q->slots = lca_malloc_wipe (depth * sizeof (struct work_slot));
+  q->depth = depth;
+  q->source = source;
+  q->ctx = ctx;
+
+  pthread_mutex_init (&q->lock, NULL);
+  pthread_cond_init (&q->slot_free, NULL);
+  pthread_cond_init (&q->slot_ready, NULL);
+
+  return q;
+}
+
+void
+work_queue_free (struct work_queue *q)
+{
+  assert (NULL != q);
+
+  pthread_cond_destroy (&q->slot_ready);
+  pthread_cond_destroy (&q->slot_free);
+  pthread_mutex_destroy (&q->lock);
+
+  free (q->slots);
+  free (q);
+}
+
+bool
+work_queue_claim (struct work_queue *q, unsigned long *seq, void **input)
+{
+  return 1 == work_queue_claim_batch (q, 1, seq, input);
+}
+
+unsigned int
+work_queue_claim_batch (struct work_queue *q, unsigned int max,
+                        unsigned long *seqs, void **inputs)
+{
+  unsigned int claimed = 0;
+
+  assert (NULL != q);
+  assert (NULL != seqs);
+  assert (NULL != inputs);
+
+  pthread_mutex_lock (&q->lock);
+
+  while (!q->drained && q->next - q->head >= q->depth)
+    pthread_cond_wait (&q->slot_free, &q->lock);
+
+  while (!q->drained && claimed < max && q->next - q->head < q->depth)
+    {
+      if ((inputs[claimed] = q->source (q->ctx)) != NULL)
+        {
+          seqs[claimed++] = q->next++;
+        }
+      else
+        {
+          q->drained = true;
+          /* Wake the consumer, which may be waiting on nothing, and
+             the other workers */
+          pthread_cond_broadcast (&q->slot_ready);
+          pthread_cond_broadcast (&q->slot_free);
+        }
+    }
+
+  pthread_mutex_unlock (&q->lock);
+
+  return claimed;
+}
+
+void
+work_queue_publish (struct work_queue *q, unsigned long seq, void *item)
+{
+  assert (NULL != q);
+
+  pthread_mutex_lock (&q->lock);
+
+  struct work_slot *slot = &q->slots[seq % q->depth];
+
+  assert (!slot->ready);
+  slot->item = item;
+  slot->ready = true;
+
+  if (seq == q->head)
+    pthread_cond_signal (&q->slot_ready);
+
+  pthread_mutex_unlock (&q->lock);
+}
+
+bool
+work_queue_take (struct work_queue *q, void **item)
+{
+  bool taken = false;
+
+  assert (NULL != q);
+  assert (NULL != item);
+
+  pthread_mutex_lock (&q->lock);
+
+  struct work_slot *slot = &q->slots[q->head % q->depth];
+
+  while (!slot->ready && !(q->drained && q->head == q->next))
+    pthread_cond_wait (&q->slot_ready, &q->lock);
+
+  if (slot->ready)
+    {
+      *item = slot->item;
+      slot->item = NULL;
+      slot->ready = false;
+      q->head++;
+      taken = true;
+      pthread_cond_signal (&q->slot_free);
+    }
+
+  pthread_mutex_unlock (&q->lock);
+
+  return taken;
+}
+
+unsigned int
+default_jobs (void)
+{
+  long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+
+  return cpus > 0 ? cpus : 1;
+}
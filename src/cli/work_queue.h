@@ -0,0 +1,128 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef WORK_QUEUE_H
+#define WORK_QUEUE_H
+
+#include <stdbool.h>
+#include <pthread.h>
+
+/* A bounded queue that hands out input to worker threads and returns
+   their results to a single consumer in input order.  At most depth
+   items are in flight between claim and take, which keeps memory flat
+   no matter how long the input is.
+*/
+
+/* Returns the next input, or NULL when the input is exhausted.  It is
+   called with the queue lock held, so it need not be thread safe. */
+typedef void *(*work_source) (void *ctx);
+
+struct work_slot
+{
+  bool ready;
+  void *item;
+};
+
+struct work_queue
+{
+  pthread_mutex_t lock;
+  pthread_cond_t slot_free;
+  pthread_cond_t slot_ready;
+  work_source source;
+  void *ctx;
+  unsigned int depth;
+  unsigned long next;           /**< Sequence of the next claim */
+  unsigned long head;           /**< Sequence of the next take */
+  bool drained;                 /**< The source returned NULL */
+  struct work_slot *slots;
+};
+
+/**
+ * Create a work queue.
+ *
+ * @param depth The maximum number of items in flight
+ * @param source The input callback
+ * @param ctx Passed to the source
+ *
+ * @return A malloc'd queue, free with work_queue_free
+ */
+struct work_queue *
+work_queue_new (unsigned int depth, work_source source, void *ctx);
+
+void
+work_queue_free (struct work_queue *q);
+
+/**
+ * Claim the next input.  Blocks while depth items are in flight.
+ *
+ * @param q The queue
+ * @param seq Set to the sequence number to publish the result under
+ * @param input Set to the input from the source
+ *
+ * @return false once the input is exhausted
+ */
+bool
+work_queue_claim (struct work_queue *q, unsigned long *seq, void **input);
+
+/**
+ * Claim up to max consecutive inputs.  Blocks only for the first, so
+ * a worker never waits while holding claims the consumer needs.
+ *
+ * @param q The queue
+ * @param max The most inputs to claim
+ * @param seqs Filled with the sequence numbers, in order
+ * @param inputs Filled with the inputs
+ *
+ * @return The number claimed, 0 once the input is exhausted
+ */
+unsigned int
+work_queue_claim_batch (struct work_queue *q, unsigned int max,
+                        unsigned long *seqs, void **inputs);
+
+/**
+ * Publish the result for a claimed sequence number.
+ *
+ * @param q The queue
+ * @param seq The sequence from work_queue_claim
+ * @param item The result handed to the consumer
+ */
+void
+work_queue_publish (struct work_queue *q, unsigned long seq, void *item);
+
+/**
+ * Take the next result in input order.  Blocks until it is published.
+ *
+ * @param q The queue
+ * @param item Set to the result
+ *
+ * @return false once every input has been taken
+ */
+bool
+work_queue_take (struct work_queue *q, void **item);
+
+/**
+ * The number of worker threads to use when none was requested.
+ *
+ * @return The number of online processors, at least one
+ */
+unsigned int
+default_jobs (void);
+
+#endif /* WORK_QUEUE_H */
@@ -0,0 +1,932 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file   p256.c
+ *
+ * @brief  ECDSA P-256 verification.
+ *
+ * Field elements are four 64 bit limbs, least significant first, in
+ * Montgomery form.  The same Montgomery code serves the field (mod p)
+ * and the scalars (mod n).  Points are Jacobian, u1 G + u2 Q is
+ * computed with interleaved wNAF: a window of 7 over a table of odd
+ * multiples of G built once, and a window of 5 over odd multiples of
+ * Q built per verification.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "p256.h"
+
+typedef uint64_t fe[4];
+
+struct modulus
+{
+  fe m;
+  uint64_t m0inv;               /**< -m^-1 mod 2^64 */
+  fe one;                       /**< R mod m */
+  fe rr;                        /**< R^2 mod m */
+};
+
+struct jacobian
+{
+  fe x, y, z;                   /**< z == 0 is the point at infinity */
+};
+
+struct affine
+{
+  fe x, y;
+};
+
+#define G_WINDOW 7
+#define Q_WINDOW 5
+#define G_TABLE_LEN (1 << (G_WINDOW - 2))
+#define Q_TABLE_LEN (1 << (Q_WINDOW - 2))
+
+/* One more digit than bits, a wNAF can carry out of the top */
+#define NAF_LEN 257
+
+static struct modulus P =
+  {
+    { 0xFFFFFFFFFFFFFFFFULL, 0x00000000FFFFFFFFULL,
+      0x0000000000000000ULL, 0xFFFFFFFF00000001ULL },
+    1, {0}, {0}
+  };
+
+static struct modulus N =
+  {
+    { 0xF3B9CAC2FC632551ULL, 0xBCE6FAADA7179E84ULL,
+      0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFF00000000ULL },
+    0xCCD1C8AAEE00BC4FULL, {0}, {0}
+  };
+
+static const fe CURVE_B =
+  { 0x3BCE3C3E27D2604BULL, 0x651D06B0CC53B0F6ULL,
+    0xB3EBBD55769886BCULL, 0x5AC635D8AA3A93E7ULL };
+
+static const fe G_X =
+  { 0xF4A13945D898C296ULL, 0x77037D812DEB33A0ULL,
+    0xF8BCE6E563A440F2ULL, 0x6B17D1F2E12C4247ULL };
+
+static const fe G_Y =
+  { 0xCBB6406837BF51F5ULL, 0x2BCE33576B315ECEULL,
+    0x8EE7EB4A7C0F9E16ULL, 0x4FE342E2FE1A7F9BULL };
+
+const uint8_t p256_base_point[P256_PUB_KEY_LEN] =
+  {
+    0x04,
+    0x6B, 0x17, 0xD1, 0xF2, 0xE1, 0x2C, 0x42, 0x47,
+    0xF8, 0xBC, 0xE6, 0xE5, 0x63, 0xA4, 0x40, 0xF2,
+    0x77, 0x03, 0x7D, 0x81, 0x2D, 0xEB, 0x33, 0xA0,
+    0xF4, 0xA1, 0x39, 0x45, 0xD8, 0x98, 0xC2, 0x96,
+    0x4F, 0xE3, 0x42, 0xE2, 0xFE, 0x1A, 0x7F, 0x9B,
+    0x8E, 0xE7, 0xEB, 0x4A, 0x7C, 0x0F, 0x9E, 0x16,
+    0x2B, 0xCE, 0x33, 0x57, 0x6B, 0x31, 0x5E, 0xCE,
+    0xCB, 0xB6, 0x40, 0x68, 0x37, 0xBF, 0x51, 0xF5
+  };
+
+static fe curve_b;                     /**< b in Montgomery form */
+static struct affine g_table[G_TABLE_LEN];   /**< G, 3G, 5G, ... */
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+
+/* 64 x 64 -> 128 bit multiply accumulate: returns the low half of
+   a * b + c + *carry and leaves the high half in *carry */
+#ifdef __SIZEOF_INT128__
+static inline uint64_t
+mac (uint64_t a, uint64_t b, uint64_t c, uint64_t *carry)
+{
+  unsigned __int128 t = (unsigned __int128)a * b + c + *carry;
+
+  *carry = t >> 64;
+  return t;
+}
+#else
+static inline uint64_t
+mac (uint64_t a, uint64_t b, uint64_t c, uint64_t *carry)
+{
+  uint64_t a0 = (uint32_t)a, a1 = a >> 32;
+  uint64_t b0 = (uint32_t)b, b1 = b >> 32;
+  uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+  uint64_t mid = (p00 >> 32) + (uint32_t)p01 + (uint32_t)p10;
+  uint64_t lo = (mid << 32) | (uint32_t)p00;
+  uint64_t hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+
+  lo += c;
+  hi += lo < c;
+  lo += *carry;
+  hi += lo < *carry;
+
+  *carry = hi;
+  return lo;
+}
+#endif
+
+static inline uint64_t
+addc (uint64_t a, uint64_t b, uint64_t *carry)
+{
+  uint64_t t = a + *carry;
+  uint64_t c = t < a;
+
+  t += b;
+  *carry = c | (t < b);
+
+  return t;
+}
+
+static inline uint64_t
+subb (uint64_t a, uint64_t b, uint64_t *borrow)
+{
+  uint64_t t = a - b;
+  uint64_t c = a < b;
+
+  c |= t < *borrow;
+  t -= *borrow;
+  *borrow = c;
+
+  return t;
+}
+
+/**
+ * r = t - m if that does not borrow (counting the extra top word),
+ * else t.  Branch free.
+ */
+static inline void
+reduce_once (fe r, const uint64_t *t, uint64_t top, const fe m)
+{
+  fe d;
+  uint64_t borrow = 0;
+  uint64_t mask = 0;
+  int x = 0;
+
+#pragma GCC unroll 4
+  for (x = 0; x < 4; x++)
+    d[x] = subb (t[x], m[x], &borrow);
+
+  subb (top, 0, &borrow);
+
+  /* borrow set means t < m, keep t */
+  mask = 0 - borrow;
+
+#pragma GCC unroll 4
+  for (x = 0; x < 4; x++)
+    r[x] = (t[x] & mask) | (d[x] & ~mask);
+}
+
+/* One CIOS round: t += a * b_i, then add the multiple of m that
+   clears the low word and shift down a word.  The modulus is passed
+   as constants so p's zero limb and m0inv of 1 fold away. */
+#define CIOS_ROUND(bi, M0INV, M0, M1, M2, M3)                           \
+  do                                                                    \
+    {                                                                   \
+      carry = 0;                                                        \
+      t0 = mac (a[0], bi, t0, &carry);                                  \
+      t1 = mac (a[1], bi, t1, &carry);                                  \
+      t2 = mac (a[2], bi, t2, &carry);                                  \
+      t3 = mac (a[3], bi, t3, &carry);                                  \
+      t4 += carry;                                                      \
+      t5 = t4 < carry;                                                  \
+                                                                        \
+      m = t0 * (M0INV);                                                 \
+      carry = 0;                                                        \
+      mac (m, M0, t0, &carry);                                          \
+      t0 = mac (m, M1, t1, &carry);                                     \
+      t1 = mac (m, M2, t2, &carry);                                     \
+      t2 = mac (m, M3, t3, &carry);                                     \
+      t3 = t4 + carry;                                                  \
+      t4 = t5 + (t3 < carry);                                           \
+    }                                                                   \
+  while (0)
+
+#define DEFINE_MONT_MUL(NAME, M0INV, M0, M1, M2, M3)                    \
+  static void                                                           \
+  NAME (fe r, const fe a, const fe b)                                   \
+  {                                                                     \
+    static const fe mod = { M0, M1, M2, M3 };                           \
+    uint64_t t0 = 0, t1 = 0, t2 = 0, t3 = 0, t4 = 0, t5 = 0;            \
+    uint64_t carry = 0;                                                 \
+    uint64_t m = 0;                                                     \
+    uint64_t t[4];                                                      \
+                                                                        \
+    CIOS_ROUND (b[0], M0INV, M0, M1, M2, M3);                           \
+    CIOS_ROUND (b[1], M0INV, M0, M1, M2, M3);                           \
+    CIOS_ROUND (b[2], M0INV, M0, M1, M2, M3);                           \
+    CIOS_ROUND (b[3], M0INV, M0, M1, M2, M3);                           \
+                                                                        \
+    t[0] = t0;                                                          \
+    t[1] = t1;                                                          \
+    t[2] = t2;                                                          \
+    t[3] = t3;                                                          \
+                                                                        \
+    reduce_once (r, t, t4, mod);                                        \
+  }
+
+DEFINE_MONT_MUL (p_mul, 1, 0xFFFFFFFFFFFFFFFFULL, 0x00000000FFFFFFFFULL,
+                 0x0000000000000000ULL, 0xFFFFFFFF00000001ULL)
+DEFINE_MONT_MUL (n_mul, 0xCCD1C8AAEE00BC4FULL, 0xF3B9CAC2FC632551ULL,
+                 0xBCE6FAADA7179E84ULL, 0xFFFFFFFFFFFFFFFFULL,
+                 0xFFFFFFFF00000000ULL)
+
+/* r = a * b / R mod m */
+static inline void
+mont_mul (fe r, const fe a, const fe b, const struct modulus *mod)
+{
+  if (mod == &P)
+    p_mul (r, a, b);
+  else
+    n_mul (r, a, b);
+}
+
+static inline void
+mont_sqr (fe r, const fe a, const struct modulus *mod)
+{
+  mont_mul (r, a, a, mod);
+}
+
+static inline void
+mod_add (fe r, const fe a, const fe b, const struct modulus *mod)
+{
+  uint64_t t[4];
+  uint64_t carry = 0;
+  int x = 0;
+
+#pragma GCC unroll 4
+  for (x = 0; x < 4; x++)
+    t[x] = addc (a[x], b[x], &carry);
+
+  reduce_once (r, t, carry, mod->m);
+}
+
+static inline void
+mod_sub (fe r, const fe a, const fe b, const struct modulus *mod)
+{
+  uint64_t borrow = 0;
+  uint64_t carry = 0;
+  uint64_t mask = 0;
+  fe t;
+  int x = 0;
+
+#pragma GCC unroll 4
+  for (x = 0; x < 4; x++)
+    t[x] = subb (a[x], b[x], &borrow);
+
+  /* Add m back if it went negative */
+  mask = 0 - borrow;
+
+#pragma GCC unroll 4
+  for (x = 0; x < 4; x++)
+    r[x] = addc (t[x], mod->m[x] & mask, &carry);
+}
+
+static inline bool
+fe_is_zero (const fe a)
+{
+  return 0 == (a[0] | a[1] | a[2] | a[3]);
+}
+
+static inline bool
+fe_equal (const fe a, const fe b)
+{
+  return 0 == ((a[0] ^ b[0]) | (a[1] ^ b[1]) | (a[2] ^ b[2]) | (a[3] ^ b[3]));
+}
+
+/* a < b as integers */
+static bool
+fe_less (const fe a, const fe b)
+{
+  uint64_t borrow = 0;
+  int x = 0;
+
+  for (x = 0; x < 4; x++)
+    subb (a[x], b[x], &borrow);
+
+  return borrow;
+}
+
+static void
+to_mont (fe r, const fe a, const struct modulus *mod)
+{
+  mont_mul (r, a, mod->rr, mod);
+}
+
+/* r = a^(m - 2), the inverse of a (in Montgomery form) */
+static void
+mont_inv (fe r, const fe a, const struct modulus *mod)
+{
+  fe e;
+  fe acc;
+  uint64_t borrow = 0;
+  int bit = 0;
+  int x = 0;
+
+  for (x = 0; x < 4; x++)
+    e[x] = subb (mod->m[x], x == 0 ? 2 : 0, &borrow);
+
+  memcpy (acc, mod->one, sizeof (fe));
+
+  /* The exponent is public */
+  for (bit = 255; bit >= 0; bit--)
+    {
+      mont_sqr (acc, acc, mod);
+
+      if ((e[bit / 64] >> (bit % 64)) & 1)
+        mont_mul (acc, acc, a, mod);
+    }
+
+  memcpy (r, acc, sizeof (fe));
+}
+
+static void
+init_modulus (struct modulus *mod)
+{
+  uint64_t carry = 0;
+  int x = 0;
+
+  /* R mod m = 2^256 - m, since m > 2^255 */
+  for (x = 0; x < 4; x++)
+    mod->one[x] = addc (~mod->m[x], x == 0 ? 1 : 0, &carry);
+
+  /* Doubling R 256 times gives R^2 */
+  memcpy (mod->rr, mod->one, sizeof (fe));
+
+  for (x = 0; x < 256; x++)
+    mod_add (mod->rr, mod->rr, mod->rr, mod);
+}
+
+static void
+fe_from_bytes (fe r, const uint8_t *in)
+{
+  int x = 0, y = 0;
+
+  for (x = 0; x < 4; x++)
+    {
+      r[3 - x] = 0;
+      for (y = 0; y < 8; y++)
+        r[3 - x] = (r[3 - x] << 8) | in[8 * x + y];
+    }
+}
+
+static void
+point_double (struct jacobian *r, const struct jacobian *a)
+{
+  fe delta, gamma, beta, alpha, t1, t2;
+
+  /* dbl-2001-b, a = -3 */
+  mont_sqr (delta, a->z, &P);
+  mont_sqr (gamma, a->y, &P);
+  mont_mul (beta, a->x, gamma, &P);
+
+  mod_sub (t1, a->x, delta, &P);
+  mod_add (t2, a->x, delta, &P);
+  mont_mul (alpha, t1, t2, &P);
+  mod_add (t1, alpha, alpha, &P);
+  mod_add (alpha, t1, alpha, &P);
+
+  mod_add (t1, a->y, a->z, &P);
+  mont_sqr (t1, t1, &P);
+  mod_sub (t1, t1, gamma, &P);
+  mod_sub (r->z, t1, delta, &P);
+
+  mod_add (beta, beta, beta, &P);
+  mod_add (beta, beta, beta, &P);         /* 4 beta */
+  mont_sqr (t1, alpha, &P);
+  mod_add (t2, beta, beta, &P);
+  mod_sub (r->x, t1, t2, &P);
+
+  mod_sub (t1, beta, r->x, &P);
+  mont_mul (t1, alpha, t1, &P);
+  mont_sqr (gamma, gamma, &P);
+  mod_add (gamma, gamma, gamma, &P);
+  mod_add (gamma, gamma, gamma, &P);
+  mod_add (gamma, gamma, gamma, &P);      /* 8 gamma^2 */
+  mod_sub (r->y, t1, gamma, &P);
+}
+
+/**
+ * r = a + b where b has z1 (NULL for an affine b, z = 1).  Handles
+ * infinity and equal or opposite inputs, which a crafted key or
+ * signature can force.
+ */
+static void
+point_add (struct jacobian *r, const struct jacobian *a, const fe bx,
+           const fe by, const fe bz)
+{
+  fe z1z1, z2z2, u1, u2, s1, s2, h, i, j, rr, v, t;
+
+  if (fe_is_zero (a->z))
+    {
+      memcpy (r->x, bx, sizeof (fe));
+      memcpy (r->y, by, sizeof (fe));
+      memcpy (r->z, NULL != bz ? bz : P.one, sizeof (fe));
+      return;
+    }
+
+  if (NULL != bz && fe_is_zero (bz))
+    {
+      *r = *a;
+      return;
+    }
+
+  /* add-2007-bl, madd-2007-bl when bz is NULL */
+  mont_sqr (z1z1, a->z, &P);
+  mont_mul (u2, bx, z1z1, &P);
+  mont_mul (s2, by, a->z, &P);
+  mont_mul (s2, s2, z1z1, &P);
+
+  if (NULL != bz)
+    {
+      mont_sqr (z2z2, bz, &P);
+      mont_mul (u1, a->x, z2z2, &P);
+      mont_mul (s1, a->y, bz, &P);
+      mont_mul (s1, s1, z2z2, &P);
+    }
+  else
+    {
+      memcpy (u1, a->x, sizeof (fe));
+      memcpy (s1, a->y, sizeof (fe));
+    }
+
+  mod_sub (h, u2, u1, &P);
+  mod_sub (rr, s2, s1, &P);
+
+  if (fe_is_zero (h))
+    {
+      if (fe_is_zero (rr))
+        point_double (r, a);
+      else
+        memset (r, 0, sizeof (*r));
+      return;
+    }
+
+  mod_add (rr, rr, rr, &P);
+  mod_add (i, h, h, &P);
+  mont_sqr (i, i, &P);
+  mont_mul (j, h, i, &P);
+  mont_mul (v, u1, i, &P);
+
+  /* z3 before x3, r may alias a */
+  if (NULL != bz)
+    {
+      mod_add (t, a->z, bz, &P);
+      mont_sqr (t, t, &P);
+      mod_sub (t, t, z1z1, &P);
+      mod_sub (t, t, z2z2, &P);
+      mont_mul (r->z, t, h, &P);
+    }
+  else
+    {
+      mod_add (t, a->z, h, &P);
+      mont_sqr (t, t, &P);
+      mod_sub (t, t, z1z1, &P);
+      mont_sqr (i, h, &P);
+      mod_sub (r->z, t, i, &P);
+    }
+
+  mont_sqr (t, rr, &P);
+  mod_sub (t, t, j, &P);
+  mod_sub (t, t, v, &P);
+  mod_sub (r->x, t, v, &P);
+
+  mod_sub (t, v, r->x, &P);
+  mont_mul (t, rr, t, &P);
+  mont_mul (s1, s1, j, &P);
+  mod_add (s1, s1, s1, &P);
+  mod_sub (r->y, t, s1, &P);
+}
+
+static void
+to_affine (struct affine *r, const struct jacobian *a)
+{
+  fe zinv, zinv2;
+
+  mont_inv (zinv, a->z, &P);
+  mont_sqr (zinv2, zinv, &P);
+  mont_mul (r->x, a->x, zinv2, &P);
+  mont_mul (zinv2, zinv2, zinv, &P);
+  mont_mul (r->y, a->y, zinv2, &P);
+}
+
+static void
+init_tables (void)
+{
+  struct jacobian g, g2, acc;
+  int x = 0;
+
+  init_modulus (&P);
+  init_modulus (&N);
+  to_mont (curve_b, CURVE_B, &P);
+
+  to_mont (g.x, G_X, &P);
+  to_mont (g.y, G_Y, &P);
+  memcpy (g.z, P.one, sizeof (fe));
+
+  point_double (&g2, &g);
+  acc = g;
+
+  for (x = 0; x < G_TABLE_LEN; x++)
+    {
+      to_affine (&g_table[x], &acc);
+      point_add (&acc, &acc, g2.x, g2.y, g2.z);
+    }
+}
+
+/**
+ * Width w NAF of a scalar below 2^256.
+ *
+ * @return The number of digits
+ */
+static int
+wnaf (int8_t *naf, const fe k, int w)
+{
+  uint64_t t[5] = { k[0], k[1], k[2], k[3], 0 };
+  int len = 0;
+  int x = 0;
+
+  memset (naf, 0, NAF_LEN);
+
+  while ((t[0] | t[1] | t[2] | t[3] | t[4]) != 0)
+    {
+      int digit = 0;
+
+      if (t[0] & 1)
+        {
+          digit = t[0] & ((1 << w) - 1);
+          if (digit >= 1 << (w - 1))
+            digit -= 1 << w;
+
+          /* t -= digit, which leaves t divisible by 2^w */
+          if (digit > 0)
+            {
+              uint64_t borrow = 0;
+              t[0] = subb (t[0], digit, &borrow);
+              for (x = 1; x < 5; x++)
+                t[x] = subb (t[x], 0, &borrow);
+            }
+          else
+            {
+              uint64_t carry = 0;
+              t[0] = addc (t[0], -digit, &carry);
+              for (x = 1; x < 5; x++)
+                t[x] = addc (t[x], 0, &carry);
+            }
+        }
+
+      naf[len++] = digit;
+
+      for (x = 0; x < 4; x++)
+        t[x] = (t[x] >> 1) | (t[x + 1] << 63);
+      t[4] >>= 1;
+    }
+
+  return len;
+}
+
+static void
+negate (fe r, const fe a)
+{
+  static const fe zero = {0};
+
+  mod_sub (r, zero, a, &P);
+}
+
+static bool
+on_curve (const fe x, const fe y)
+{
+  fe lhs, rhs, t;
+
+  mont_sqr (lhs, y, &P);
+
+  mont_sqr (rhs, x, &P);
+  mont_mul (rhs, rhs, x, &P);
+  mod_add (t, x, x, &P);
+  mod_add (t, t, x, &P);
+  mod_sub (rhs, rhs, t, &P);
+  mod_add (rhs, rhs, curve_b, &P);
+
+  return fe_equal (lhs, rhs);
+}
+
+/**
+ * Parse an uncompressed public key into Montgomery form.
+ *
+ * @return false unless it is a point on the curve
+ */
+static bool
+load_point (const uint8_t *pub_key, struct jacobian *q)
+{
+  fe qx, qy;
+
+  if (0x04 != pub_key[0])
+    return false;
+
+  fe_from_bytes (qx, pub_key + 1);
+  fe_from_bytes (qy, pub_key + 33);
+
+  if (!fe_less (qx, P.m) || !fe_less (qy, P.m))
+    return false;
+
+  to_mont (q->x, qx, &P);
+  to_mont (q->y, qy, &P);
+  memcpy (q->z, P.one, sizeof (fe));
+
+  return on_curve (q->x, q->y);
+}
+
+/**
+ * Check the signature's range and compute the scalars of
+ * u1 G + u2 Q: w = s^-1, u1 = e w, u2 = r w, all mod n.
+ *
+ * @return false if r or s is out of range
+ */
+static bool
+load_scalars (const uint8_t *signature, const uint8_t *digest, fe r, fe u1,
+              fe u2)
+{
+  fe s, e, w;
+  int x = 0;
+
+  fe_from_bytes (r, signature);
+  fe_from_bytes (s, signature + 32);
+  fe_from_bytes (e, digest);
+
+  if (fe_is_zero (r) || !fe_less (r, N.m) ||
+      fe_is_zero (s) || !fe_less (s, N.m))
+    return false;
+
+  if (!fe_less (e, N.m))
+    {
+      uint64_t borrow = 0;
+      for (x = 0; x < 4; x++)
+        e[x] = subb (e[x], N.m[x], &borrow);
+    }
+
+  to_mont (w, s, &N);
+  mont_inv (w, w, &N);
+  mont_mul (u1, e, w, &N);
+  mont_mul (u2, r, w, &N);
+
+  return true;
+}
+
+/**
+ * Whether x(acc) mod n == r, without an inversion: X == r Z^2, or
+ * (r + n) Z^2 when r + n is still below p.
+ */
+static bool
+check_r (const struct jacobian *acc, const fe r)
+{
+  fe z2, w, rn;
+  uint64_t carry = 0;
+  int x = 0;
+
+  if (fe_is_zero (acc->z))
+    return false;
+
+  mont_sqr (z2, acc->z, &P);
+  to_mont (w, r, &P);
+  mont_mul (w, w, z2, &P);
+
+  if (fe_equal (w, acc->x))
+    return true;
+
+  for (x = 0; x < 4; x++)
+    rn[x] = addc (r[x], N.m[x], &carry);
+
+  if (0 != carry || !fe_less (rn, P.m))
+    return false;
+
+  to_mont (w, rn, &P);
+  mont_mul (w, w, z2, &P);
+
+  return fe_equal (w, acc->x);
+}
+
+bool
+p256_verify (const uint8_t *pub_key, const uint8_t *signature,
+             const uint8_t *digest)
+{
+  fe r, u1, u2, t;
+  struct jacobian q, q2, acc;
+  struct jacobian q_table[Q_TABLE_LEN];
+  int8_t naf1[NAF_LEN], naf2[NAF_LEN];
+  int len1 = 0, len2 = 0;
+  int x = 0;
+
+  assert (NULL != pub_key);
+  assert (NULL != signature);
+  assert (NULL != digest);
+
+  pthread_once (&init_once, init_tables);
+
+  if (!load_point (pub_key, &q) || !load_scalars (signature, digest, r, u1, u2))
+    return false;
+
+  /* Odd multiples of Q */
+  point_double (&q2, &q);
+  q_table[0] = q;
+  for (x = 1; x < Q_TABLE_LEN; x++)
+    point_add (&q_table[x], &q_table[x - 1], q2.x, q2.y, q2.z);
+
+  len1 = wnaf (naf1, u1, G_WINDOW);
+  len2 = wnaf (naf2, u2, Q_WINDOW);
+
+  memset (&acc, 0, sizeof (acc));
+
+  for (x = (len1 > len2 ? len1 : len2) - 1; x >= 0; x--)
+    {
+      if (!fe_is_zero (acc.z))
+        point_double (&acc, &acc);
+
+      if (naf1[x] > 0)
+        point_add (&acc, &acc, g_table[naf1[x] / 2].x,
+                   g_table[naf1[x] / 2].y, NULL);
+      else if (naf1[x] < 0)
+        {
+          negate (t, g_table[-naf1[x] / 2].y);
+          point_add (&acc, &acc, g_table[-naf1[x] / 2].x, t, NULL);
+        }
+
+      if (naf2[x] > 0)
+        point_add (&acc, &acc, q_table[naf2[x] / 2].x,
+                   q_table[naf2[x] / 2].y, q_table[naf2[x] / 2].z);
+      else if (naf2[x] < 0)
+        {
+          negate (t, q_table[-naf2[x] / 2].y);
+          point_add (&acc, &acc, q_table[-naf2[x] / 2].x, t,
+                     q_table[-naf2[x] / 2].z);
+        }
+    }
+
+  return check_r (&acc, r);
+}
+
+/**
+ * Signed base 2^5 digits of a scalar below 2^256, each in
+ * [-15, 16], one per comb window.
+ */
+static void
+comb_digits (int8_t *digits, const fe k)
+{
+  int carry = 0;
+  int bit = 0;
+  int x = 0;
+
+  for (x = 0; x < P256_COMB_WINDOWS; x++)
+    {
+      int chunk = 0;
+
+      bit = x * P256_COMB_WINDOW;
+      chunk = k[bit / 64] >> (bit % 64);
+      if (bit % 64 > 64 - P256_COMB_WINDOW && bit / 64 < 3)
+        chunk |= k[bit / 64 + 1] << (64 - bit % 64);
+      chunk = (chunk & ((1 << P256_COMB_WINDOW) - 1)) + carry;
+
+      carry = chunk > P256_COMB_POINTS;
+      digits[x] = chunk - (carry << P256_COMB_WINDOW);
+    }
+}
+
+/* acc += digit times the window's base point */
+static void
+comb_add (struct jacobian *acc,
+          const uint64_t (*row)[2][4], int digit)
+{
+  fe t;
+
+  if (digit > 0)
+    point_add (acc, acc, row[digit - 1][0], row[digit - 1][1], NULL);
+  else if (digit < 0)
+    {
+      negate (t, row[-digit - 1][1]);
+      point_add (acc, acc, row[-digit - 1][0], t, NULL);
+    }
+}
+
+bool
+p256_precompute (const uint8_t *pub_key, struct p256_table *table)
+{
+  const int num = P256_COMB_WINDOWS * P256_COMB_POINTS;
+  struct jacobian base;
+  struct jacobian *points = NULL;
+  fe *prod = NULL;
+  fe inv, zinv, zinv2;
+  int w = 0, j = 0, x = 0;
+
+  assert (NULL != pub_key);
+  assert (NULL != table);
+
+  pthread_once (&init_once, init_tables);
+
+  if (!load_point (pub_key, &base))
+    return false;
+
+  points = malloc (num * sizeof (struct jacobian));
+  prod = malloc (num * sizeof (fe));
+
+  if (NULL == points || NULL == prod)
+    {
+      free (prod);
+      free (points);
+      return false;
+    }
+
+  /* Row w holds 1..16 times 2^(5 w) Q */
+  for (w = 0; w < P256_COMB_WINDOWS; w++)
+    {
+      struct jacobian *row = points + w * P256_COMB_POINTS;
+
+      row[0] = base;
+      for (j = 1; j < P256_COMB_POINTS; j++)
+        if (j & 1)
+          point_double (&row[j], &row[j / 2]);
+        else
+          point_add (&row[j], &row[j - 1], base.x, base.y, base.z);
+
+      point_double (&base, &row[P256_COMB_POINTS - 1]);
+    }
+
+  /* None of them is infinity, every multiple is below n times a
+     power of two and n is prime.  Invert every Z at once. */
+  memcpy (prod[0], points[0].z, sizeof (fe));
+  for (x = 1; x < num; x++)
+    mont_mul (prod[x], prod[x - 1], points[x].z, &P);
+
+  mont_inv (inv, prod[num - 1], &P);
+
+  for (x = num - 1; x >= 0; x--)
+    {
+      if (x > 0)
+        {
+          mont_mul (zinv, inv, prod[x - 1], &P);
+          mont_mul (inv, inv, points[x].z, &P);
+        }
+      else
+        memcpy (zinv, inv, sizeof (fe));
+
+      mont_sqr (zinv2, zinv, &P);
+      mont_mul (table->points[x / P256_COMB_POINTS][x % P256_COMB_POINTS][0],
+                points[x].x, zinv2, &P);
+      mont_mul (zinv2, zinv2, zinv, &P);
+      mont_mul (table->points[x / P256_COMB_POINTS][x % P256_COMB_POINTS][1],
+                points[x].y, zinv2, &P);
+    }
+
+  free (prod);
+  free (points);
+
+  return true;
+}
+
+bool
+p256_verify_precomputed (const struct p256_table *g,
+                         const struct p256_table *q,
+                         const uint8_t *signature, const uint8_t *digest)
+{
+  fe r, u1, u2;
+  int8_t d1[P256_COMB_WINDOWS], d2[P256_COMB_WINDOWS];
+  struct jacobian acc;
+  int x = 0;
+
+  assert (NULL != g);
+  assert (NULL != q);
+  assert (NULL != signature);
+  assert (NULL != digest);
+
+  pthread_once (&init_once, init_tables);
+
+  if (!load_scalars (signature, digest, r, u1, u2))
+    return false;
+
+  comb_digits (d1, u1);
+  comb_digits (d2, u2);
+
+  /* Only additions, the doublings are in the tables */
+  memset (&acc, 0, sizeof (acc));
+
+  for (x = 0; x < P256_COMB_WINDOWS; x++)
+    {
+      comb_add (&acc, g->points[x], d1[x]);
+      comb_add (&acc, q->points[x], d2[x]);
+    }
+
+  return check_r (&acc, r);
+}
@@ -0,0 +1,90 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef P256_H
+#define P256_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define P256_PUB_KEY_LEN 65         /**< 0x04, X, Y */
+#define P256_SIGNATURE_LEN 64       /**< R, S */
+#define P256_DIGEST_LEN 32
+
+/* Fixed window tables: row w holds 1..16 times 2^(5 w) of a point */
+#define P256_COMB_WINDOW 5
+#define P256_COMB_POINTS (1 << (P256_COMB_WINDOW - 1))
+#define P256_COMB_WINDOWS ((256 + P256_COMB_WINDOW - 1) / P256_COMB_WINDOW)
+
+/* Affine X and Y in the verifier's internal form, native byte order */
+struct p256_table
+{
+  uint64_t points[P256_COMB_WINDOWS][P256_COMB_POINTS][2][4];
+};
+
+/* The generator, encoded as a public key */
+extern const uint8_t p256_base_point[P256_PUB_KEY_LEN];
+
+/**
+ * Verify an ECDSA P-256 signature over a SHA256 digest.
+ *
+ * The field arithmetic has no secret dependent branches, but every
+ * input to a verification is public, so the scalar multiplication
+ * uses faster variable time wNAF.  Do not reuse it for signing.
+ *
+ * @param pub_key The uncompressed public key, which must be on the
+ * curve
+ * @param signature R and S, each in [1, n - 1]
+ * @param digest The 32 byte digest
+ *
+ * @return true if the signature is valid
+ */
+bool p256_verify (const uint8_t *pub_key, const uint8_t *signature,
+                  const uint8_t *digest);
+
+/**
+ * Fill a fixed window table for a public key, or for p256_base_point.
+ * It takes about as long as a few verifications.
+ *
+ * @param pub_key The uncompressed public key
+ * @param table Filled with the multiples
+ *
+ * @return false if the key is not on the curve
+ */
+bool p256_precompute (const uint8_t *pub_key, struct p256_table *table);
+
+/**
+ * Verify with tables from p256_precompute, which replace every point
+ * doubling with a lookup.  Same result as p256_verify for the key the
+ * q table was built from.
+ *
+ * @param g The table of p256_base_point
+ * @param q The table of the public key
+ * @param signature R and S
+ * @param digest The 32 byte digest
+ *
+ * @return true if the signature is valid
+ */
+bool p256_verify_precomputed (const struct p256_table *g,
+                              const struct p256_table *q,
+                              const uint8_t *signature,
+                              const uint8_t *digest);
+
+#endif /* P256_H */
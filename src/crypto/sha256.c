@@ -0,0 +1,351 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sha256.h"
+#include "sha256_engines.h"
+
+const uint32_t SHA256_K[64] =
+  {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+  };
+
+static const uint32_t H0[8] =
+  {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+  };
+
+#define ROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define CH(x, y, z) (((x) & (y)) ^ (~(x) & (z)))
+#define MAJ(x, y, z) (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+#define BSIG0(x) (ROR (x, 2) ^ ROR (x, 13) ^ ROR (x, 22))
+#define BSIG1(x) (ROR (x, 6) ^ ROR (x, 11) ^ ROR (x, 25))
+#define SSIG0(x) (ROR (x, 7) ^ ROR (x, 18) ^ ((x) >> 3))
+#define SSIG1(x) (ROR (x, 17) ^ ROR (x, 19) ^ ((x) >> 10))
+
+static uint32_t
+load_be32 (const uint8_t *p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+    ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void
+store_be32 (uint8_t *p, uint32_t v)
+{
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+}
+
+/* One round, with the working variables renamed by the caller
+   instead of shifted */
+#define ROUND(a, b, c, d, e, f, g, h, x)                                \
+  do                                                                    \
+    {                                                                   \
+      uint32_t t1 = h + BSIG1 (e) + CH (e, f, g) + SHA256_K[x] + w[x];  \
+      d += t1;                                                          \
+      h = t1 + BSIG0 (a) + MAJ (a, b, c);                               \
+    }                                                                   \
+  while (0)
+
+void
+sha256_blocks_portable (uint32_t *state, const uint8_t *data,
+                        size_t num_blocks)
+{
+  uint32_t w[64];
+  uint32_t a, b, c, d, e, f, g, h;
+  int x = 0;
+
+  while (num_blocks-- > 0)
+    {
+      for (x = 0; x < 16; x++)
+        w[x] = load_be32 (data + 4 * x);
+
+      for (x = 16; x < 64; x++)
+        w[x] = SSIG1 (w[x - 2]) + w[x - 7] + SSIG0 (w[x - 15]) + w[x - 16];
+
+      a = state[0];
+      b = state[1];
+      c = state[2];
+      d = state[3];
+      e = state[4];
+      f = state[5];
+      g = state[6];
+      h = state[7];
+
+      for (x = 0; x < 64; x += 8)
+        {
+          ROUND (a, b, c, d, e, f, g, h, x);
+          ROUND (h, a, b, c, d, e, f, g, x + 1);
+          ROUND (g, h, a, b, c, d, e, f, x + 2);
+          ROUND (f, g, h, a, b, c, d, e, x + 3);
+          ROUND (e, f, g, h, a, b, c, d, x + 4);
+          ROUND (d, e, f, g, h, a, b, c, x + 5);
+          ROUND (c, d, e, f, g, h, a, b, x + 6);
+          ROUND (b, c, d, e, f, g, h, a, x + 7);
+        }
+
+      state[0] += a;
+      state[1] += b;
+      state[2] += c;
+      state[3] += d;
+      state[4] += e;
+      state[5] += f;
+      state[6] += g;
+      state[7] += h;
+
+      data += SHA256_BLOCK_LEN;
+    }
+}
+
+struct sha256_engine
+{
+  const char *name;
+  bool (*supported) (void);
+  sha256_blocks_fn blocks;
+};
+
+static bool
+always (void)
+{
+  return true;
+}
+
+/* Fastest first */
+static const struct sha256_engine engines[] =
+  {
+    { "shani", sha256_have_shani, sha256_blocks_shani },
+    { "armv8", sha256_have_armv8, sha256_blocks_armv8 },
+    { "portable", always, sha256_blocks_portable }
+  };
+
+#define NUM_ENGINES (sizeof (engines) / sizeof (engines[0]))
+
+static const struct sha256_engine *engine = NULL;
+static pthread_once_t engine_once = PTHREAD_ONCE_INIT;
+
+static void
+select_engine (void)
+{
+  const char *forced = getenv (SHA256_ENGINE_ENV);
+  unsigned int x = 0;
+
+  if (NULL == forced || !sha256_set_engine (forced))
+    for (x = 0; x < NUM_ENGINES && NULL == engine; x++)
+      if (engines[x].supported ())
+        engine = &engines[x];
+}
+
+static void
+sha256_blocks (uint32_t *state, const uint8_t *data, size_t num_blocks)
+{
+  pthread_once (&engine_once, select_engine);
+
+  engine->blocks (state, data, num_blocks);
+}
+
+const char *
+sha256_engine (void)
+{
+  pthread_once (&engine_once, select_engine);
+
+  return engine->name;
+}
+
+bool
+sha256_set_engine (const char *name)
+{
+  unsigned int x = 0;
+
+  assert (NULL != name);
+
+  for (x = 0; x < NUM_ENGINES; x++)
+    if (0 == strcmp (name, engines[x].name) && engines[x].supported ())
+      {
+        engine = &engines[x];
+        return true;
+      }
+
+  return false;
+}
+
+void
+sha256_init (struct sha256_ctx *ctx)
+{
+  assert (NULL != ctx);
+
+  memcpy (ctx->state, H0, sizeof (H0));
+  ctx->len = 0;
+}
+
+void
+sha256_resume (struct sha256_ctx *ctx, const uint32_t *state, uint64_t len)
+{
+  assert (NULL != ctx);
+  assert (NULL != state);
+  assert (0 == len % SHA256_BLOCK_LEN);
+
+  memcpy (ctx->state, state, sizeof (ctx->state));
+  ctx->len = len;
+}
+
+void
+sha256_update (struct sha256_ctx *ctx, const void *data, size_t len)
+{
+  const uint8_t *p = data;
+  size_t used = 0;
+
+  assert (NULL != ctx);
+  assert (NULL != data || 0 == len);
+
+  used = ctx->len % SHA256_BLOCK_LEN;
+  ctx->len += len;
+
+  /* Finish a partial block first */
+  if (used > 0)
+    {
+      size_t fill = SHA256_BLOCK_LEN - used;
+
+      if (len < fill)
+        {
+          memcpy (ctx->buf + used, p, len);
+          return;
+        }
+
+      memcpy (ctx->buf + used, p, fill);
+      sha256_blocks (ctx->state, ctx->buf, 1);
+      p += fill;
+      len -= fill;
+    }
+
+  /* Then hash whole blocks straight from the caller's buffer */
+  if (len >= SHA256_BLOCK_LEN)
+    {
+      sha256_blocks (ctx->state, p, len / SHA256_BLOCK_LEN);
+      p += len - len % SHA256_BLOCK_LEN;
+      len %= SHA256_BLOCK_LEN;
+    }
+
+  memcpy (ctx->buf, p, len);
+}
+
+void
+sha256_final (struct sha256_ctx *ctx, uint8_t *digest)
+{
+  size_t used = 0;
+  uint64_t bits = 0;
+  int x = 0;
+
+  assert (NULL != ctx);
+  assert (NULL != digest);
+
+  used = ctx->len % SHA256_BLOCK_LEN;
+  bits = ctx->len * 8;
+
+  ctx->buf[used++] = 0x80;
+
+  if (used > SHA256_BLOCK_LEN - 8)
+    {
+      memset (ctx->buf + used, 0, SHA256_BLOCK_LEN - used);
+      sha256_blocks (ctx->state, ctx->buf, 1);
+      used = 0;
+    }
+
+  memset (ctx->buf + used, 0, SHA256_BLOCK_LEN - 8 - used);
+  store_be32 (ctx->buf + SHA256_BLOCK_LEN - 8, bits >> 32);
+  store_be32 (ctx->buf + SHA256_BLOCK_LEN - 4, bits);
+  sha256_blocks (ctx->state, ctx->buf, 1);
+
+  for (x = 0; x < 8; x++)
+    store_be32 (digest + 4 * x, ctx->state[x]);
+
+  memset (ctx, 0, sizeof (*ctx));
+}
+
+void
+sha256 (const void *data, size_t len, uint8_t *digest)
+{
+  struct sha256_ctx ctx;
+
+  sha256_init (&ctx);
+  sha256_update (&ctx, data, len);
+  sha256_final (&ctx, digest);
+}
+
+void
+hmac_sha256 (const uint8_t *key, size_t key_len, const void *data,
+             size_t len, uint8_t *mac)
+{
+  struct sha256_ctx ctx;
+  uint8_t block[SHA256_BLOCK_LEN];
+  uint8_t inner[SHA256_DIGEST_LEN];
+  unsigned int x = 0;
+
+  assert (NULL != key);
+  assert (NULL != mac);
+
+  /* RFC 2104: long keys are hashed first, short ones zero padded */
+  memset (block, 0, sizeof (block));
+  if (key_len > SHA256_BLOCK_LEN)
+    sha256 (key, key_len, block);
+  else
+    memcpy (block, key, key_len);
+
+  for (x = 0; x < sizeof (block); x++)
+    block[x] ^= 0x36;
+
+  sha256_init (&ctx);
+  sha256_update (&ctx, block, sizeof (block));
+  sha256_update (&ctx, data, len);
+  sha256_final (&ctx, inner);
+
+  /* 0x36 ^ 0x5c */
+  for (x = 0; x < sizeof (block); x++)
+    block[x] ^= 0x6a;
+
+  sha256_init (&ctx);
+  sha256_update (&ctx, block, sizeof (block));
+  sha256_update (&ctx, inner, sizeof (inner));
+  sha256_final (&ctx, mac);
+
+  memset (block, 0, sizeof (block));
+}
@@ -0,0 +1,106 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHA256_DIGEST_LEN 32
+#define SHA256_BLOCK_LEN 64
+
+/* Forces an engine by name, mostly for benchmarking */
+#define SHA256_ENGINE_ENV "ECLET_SHA256_ENGINE"
+
+/* Incremental SHA256 (FIPS 180-4) */
+struct sha256_ctx
+{
+  uint32_t state[8];            /**< The chaining value */
+  uint64_t len;                 /**< Bytes hashed so far */
+  uint8_t buf[SHA256_BLOCK_LEN]; /**< Partial block */
+};
+
+void sha256_init (struct sha256_ctx *ctx);
+
+void sha256_update (struct sha256_ctx *ctx, const void *data, size_t len);
+
+/**
+ * Continue a hash from a chaining value saved at a block boundary, as
+ * if the first len bytes had just been hashed.
+ *
+ * @param ctx The context
+ * @param state The saved chaining value, ctx->state at the time
+ * @param len The bytes hashed so far, a multiple of the block length
+ */
+void sha256_resume (struct sha256_ctx *ctx, const uint32_t *state,
+                    uint64_t len);
+
+/**
+ * Finish the hash.  The context must be initialized again before
+ * reuse.
+ *
+ * @param ctx The context
+ * @param digest Filled with the 32 byte digest
+ */
+void sha256_final (struct sha256_ctx *ctx, uint8_t *digest);
+
+/**
+ * Hash a buffer in one call.
+ *
+ * @param data The data
+ * @param len The length of data
+ * @param digest Filled with the 32 byte digest
+ */
+void sha256 (const void *data, size_t len, uint8_t *digest);
+
+/**
+ * HMAC-SHA256 (RFC 2104).
+ *
+ * @param key The key
+ * @param key_len The length of key
+ * @param data The message
+ * @param len The length of data
+ * @param mac Filled with the 32 byte MAC
+ */
+void hmac_sha256 (const uint8_t *key, size_t key_len, const void *data,
+                  size_t len, uint8_t *mac);
+
+/**
+ * The block engine in use.  On first use the fastest engine the CPU
+ * supports is chosen (the x86 or ARMv8 SHA extensions, otherwise
+ * portable C) unless the ECLET_SHA256_ENGINE environment variable
+ * names a supported one.
+ *
+ * @return "shani", "armv8" or "portable"
+ */
+const char * sha256_engine (void);
+
+/**
+ * Use the named engine from now on.
+ *
+ * @param name The engine's name
+ *
+ * @return false if the engine is unknown or this CPU lacks it
+ */
+bool sha256_set_engine (const char *name);
+
+#endif /* SHA256_H */
@@ -0,0 +1,114 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file   sha256_arm.c
+ *
+ * @brief  SHA256 with the ARMv8 cryptography extensions, detected
+ * through the kernel's HWCAP.  The BeagleBone Black's Cortex-A8 is
+ * ARMv7 and has no such instructions, so it uses the portable kernel.
+ */
+
+#include <assert.h>
+
+#include "sha256_engines.h"
+
+#if defined (__aarch64__) && defined (__linux__)
+
+#include <arm_neon.h>
+#include <sys/auxv.h>
+
+#ifndef HWCAP_SHA2
+#define HWCAP_SHA2 (1 << 6)
+#endif
+
+bool
+sha256_have_armv8 (void)
+{
+  return (getauxval (AT_HWCAP) & HWCAP_SHA2) != 0;
+}
+
+/* Four rounds per iteration, W[i % 4] holding the message words for
+   rounds 4i to 4i+3. */
+__attribute__ ((target ("+crypto")))
+void
+sha256_blocks_armv8 (uint32_t *state, const uint8_t *data,
+                     size_t num_blocks)
+{
+  uint32x4_t state0, state1, abcd, efgh, wk, tmp;
+  uint32x4_t w[4];
+  int i = 0;
+
+  assert (NULL != state);
+
+  state0 = vld1q_u32 (&state[0]);
+  state1 = vld1q_u32 (&state[4]);
+
+  while (num_blocks-- > 0)
+    {
+      abcd = state0;
+      efgh = state1;
+
+      for (i = 0; i < 4; i++)
+        w[i] = vreinterpretq_u32_u8 (vrev32q_u8 (vld1q_u8 (data + 16 * i)));
+
+#pragma GCC unroll 16
+      for (i = 0; i < 16; i++)
+        {
+          wk = vaddq_u32 (w[i % 4], vld1q_u32 (&SHA256_K[4 * i]));
+
+          if (i < 12)
+            w[i % 4] = vsha256su0q_u32 (w[i % 4], w[(i + 1) % 4]);
+
+          tmp = state0;
+          state0 = vsha256hq_u32 (state0, state1, wk);
+          state1 = vsha256h2q_u32 (state1, tmp, wk);
+
+          if (i < 12)
+            w[i % 4] = vsha256su1q_u32 (w[i % 4], w[(i + 2) % 4],
+                                        w[(i + 3) % 4]);
+        }
+
+      state0 = vaddq_u32 (state0, abcd);
+      state1 = vaddq_u32 (state1, efgh);
+
+      data += 64;
+    }
+
+  vst1q_u32 (&state[0], state0);
+  vst1q_u32 (&state[4], state1);
+}
+
+#else
+
+bool
+sha256_have_armv8 (void)
+{
+  return false;
+}
+
+void
+sha256_blocks_armv8 (uint32_t *state, const uint8_t *data,
+                     size_t num_blocks)
+{
+  assert (false);
+}
+
+#endif
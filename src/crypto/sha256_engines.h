@@ -0,0 +1,51 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SHA256_ENGINES_H
+#define SHA256_ENGINES_H
+
+/* Internal to the SHA256 implementation: the block kernels that
+   sha256.c chooses between at run time. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Compress num_blocks consecutive 64 byte blocks into state */
+typedef void (*sha256_blocks_fn) (uint32_t *state, const uint8_t *data,
+                                  size_t num_blocks);
+
+extern const uint32_t SHA256_K[64];
+
+/* Portable C */
+void sha256_blocks_portable (uint32_t *state, const uint8_t *data,
+                             size_t num_blocks);
+
+/* x86 SHA extensions */
+bool sha256_have_shani (void);
+void sha256_blocks_shani (uint32_t *state, const uint8_t *data,
+                          size_t num_blocks);
+
+/* ARMv8 cryptography extensions */
+bool sha256_have_armv8 (void);
+void sha256_blocks_armv8 (uint32_t *state, const uint8_t *data,
+                          size_t num_blocks);
+
+#endif /* SHA256_ENGINES_H */
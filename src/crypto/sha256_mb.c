@@ -0,0 +1,341 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file   sha256_mb.c
+ *
+ * @brief  Multi-buffer SHA256.  The same round function is built for
+ * 4 lanes (SSE2, or whatever the compiler makes of GCC vectors on
+ * other architectures), 8 lanes (AVX2) and 16 lanes (AVX-512).  The
+ * state is kept word major, state[word * lanes + lane], so each
+ * working variable is one vector.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sha256_mb.h"
+#include "sha256_engines.h"
+
+/* Every lane compresses one block per call.  Idle lanes are pointed
+   at this block and their state is ignored. */
+static const uint8_t idle_block[SHA256_BLOCK_LEN];
+
+static const uint32_t H0[8] =
+  {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+  };
+
+typedef void (*sha256_mb_fn) (uint32_t *state, const uint8_t *const *blocks);
+
+#define MB_ROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+/* Define a kernel for a lane count and optional target attribute */
+#define SHA256_MB_KERNEL(NAME, LANES, ATTR)                             \
+  typedef uint32_t NAME##_vec __attribute__ ((vector_size (4 * LANES))); \
+                                                                        \
+  ATTR static void                                                      \
+  NAME (uint32_t *state, const uint8_t *const *blocks)                  \
+  {                                                                     \
+    NAME##_vec w[16], s[8], v[8];                                       \
+    int x = 0, l = 0;                                                   \
+                                                                        \
+    for (x = 0; x < 16; x++)                                            \
+      for (l = 0; l < LANES; l++)                                       \
+        {                                                               \
+          const uint8_t *p = blocks[l] + 4 * x;                         \
+          w[x][l] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |   \
+            ((uint32_t)p[2] << 8) | p[3];                               \
+        }                                                               \
+                                                                        \
+    memcpy (s, state, sizeof (s));                                      \
+    memcpy (v, state, sizeof (v));                                      \
+                                                                        \
+    for (x = 0; x < 64; x++)                                            \
+      {                                                                 \
+        NAME##_vec t1, t2, wx;                                          \
+                                                                        \
+        if (x < 16)                                                     \
+          wx = w[x];                                                    \
+        else                                                            \
+          {                                                             \
+            NAME##_vec w2 = w[(x - 2) & 15], w15 = w[(x - 15) & 15];    \
+            wx = w[x & 15] += (MB_ROR (w2, 17) ^ MB_ROR (w2, 19) ^      \
+                               (w2 >> 10)) + w[(x - 7) & 15] +          \
+              (MB_ROR (w15, 7) ^ MB_ROR (w15, 18) ^ (w15 >> 3));        \
+          }                                                             \
+                                                                        \
+        t1 = v[7] + (MB_ROR (v[4], 6) ^ MB_ROR (v[4], 11) ^             \
+                     MB_ROR (v[4], 25)) +                               \
+          ((v[4] & v[5]) ^ (~v[4] & v[6])) + SHA256_K[x] + wx;          \
+        t2 = (MB_ROR (v[0], 2) ^ MB_ROR (v[0], 13) ^                    \
+              MB_ROR (v[0], 22)) +                                      \
+          ((v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]));              \
+        v[7] = v[6];                                                    \
+        v[6] = v[5];                                                    \
+        v[5] = v[4];                                                    \
+        v[4] = v[3] + t1;                                               \
+        v[3] = v[2];                                                    \
+        v[2] = v[1];                                                    \
+        v[1] = v[0];                                                    \
+        v[0] = t1 + t2;                                                 \
+      }                                                                 \
+                                                                        \
+    for (x = 0; x < 8; x++)                                             \
+      s[x] += v[x];                                                     \
+                                                                        \
+    memcpy (state, s, sizeof (s));                                      \
+  }
+
+#if defined (__x86_64__) || defined (__i386__)
+SHA256_MB_KERNEL (sha256_mb_sse2, 4, __attribute__ ((target ("sse2"))))
+SHA256_MB_KERNEL (sha256_mb_avx2, 8, __attribute__ ((target ("avx2"))))
+SHA256_MB_KERNEL (sha256_mb_avx512, 16,
+                  __attribute__ ((target ("avx512f"))))
+#else
+SHA256_MB_KERNEL (sha256_mb_generic, 4, )
+#endif
+
+struct sha256_mb_engine
+{
+  const char *name;
+  unsigned int lanes;
+  sha256_mb_fn blocks;
+};
+
+static const struct sha256_mb_engine engines[] =
+  {
+#if defined (__x86_64__) || defined (__i386__)
+    { "avx512", 16, sha256_mb_avx512 },
+    { "avx2", 8, sha256_mb_avx2 },
+    { "sse2", 4, sha256_mb_sse2 },
+#else
+    { "generic", 4, sha256_mb_generic },
+#endif
+    { "none", 1, NULL }
+  };
+
+#define NUM_ENGINES (sizeof (engines) / sizeof (engines[0]))
+
+static const struct sha256_mb_engine *engine = NULL;
+static pthread_once_t engine_once = PTHREAD_ONCE_INIT;
+
+static bool
+engine_supported (const struct sha256_mb_engine *e)
+{
+#if defined (__x86_64__) || defined (__i386__)
+  __builtin_cpu_init ();
+
+  if (0 == strcmp (e->name, "avx512"))
+    return __builtin_cpu_supports ("avx512f");
+  else if (0 == strcmp (e->name, "avx2"))
+    return __builtin_cpu_supports ("avx2");
+  else if (0 == strcmp (e->name, "sse2"))
+    return __builtin_cpu_supports ("sse2");
+#endif
+
+  return true;
+}
+
+static void
+select_engine (void)
+{
+  const char *forced = getenv (SHA256_MB_ENGINE_ENV);
+  bool have_sha_ext = 0 != strcmp (sha256_engine (), "portable");
+  unsigned int x = 0;
+
+  for (x = 0; x < NUM_ENGINES && NULL != forced && NULL == engine; x++)
+    if (0 == strcmp (forced, engines[x].name) && engine_supported (&engines[x]))
+      engine = &engines[x];
+
+  /* The SHA extensions hash one message about as fast as sixteen
+     AVX-512 lanes do, and faster than eight AVX2 lanes */
+  for (x = 0; x < NUM_ENGINES && NULL == engine; x++)
+    if (engine_supported (&engines[x]) &&
+        (!have_sha_ext || engines[x].lanes >= 16 || NULL == engines[x].blocks))
+      engine = &engines[x];
+}
+
+const char *
+sha256_mb_engine (void)
+{
+  pthread_once (&engine_once, select_engine);
+
+  return engine->name;
+}
+
+unsigned int
+sha256_mb_lanes (void)
+{
+  pthread_once (&engine_once, select_engine);
+
+  return engine->lanes;
+}
+
+bool
+sha256_mb_set_engine (const char *name)
+{
+  unsigned int x = 0;
+
+  assert (NULL != name);
+
+  for (x = 0; x < NUM_ENGINES; x++)
+    if (0 == strcmp (name, engines[x].name) && engine_supported (&engines[x]))
+      {
+        engine = &engines[x];
+        return true;
+      }
+
+  return false;
+}
+
+/* Where a lane is in its message */
+struct lane
+{
+  size_t job;
+  size_t offset;                /**< Bytes of the message consumed */
+  unsigned int tail_blocks;     /**< Padding blocks, 1 or 2 */
+  unsigned int tail_done;
+  uint8_t tail[2 * SHA256_BLOCK_LEN];
+};
+
+static void
+start_lane (struct lane *lane, uint32_t *state, unsigned int lanes,
+            unsigned int l, size_t job, size_t len, const uint8_t *data)
+{
+  size_t rem = len % SHA256_BLOCK_LEN;
+  uint64_t bits = (uint64_t)len * 8;
+  unsigned int x = 0;
+
+  lane->job = job;
+  lane->offset = 0;
+  lane->tail_done = 0;
+  lane->tail_blocks = rem + 9 > SHA256_BLOCK_LEN ? 2 : 1;
+
+  /* Build the padded final block(s) up front */
+  memset (lane->tail, 0, sizeof (lane->tail));
+  memcpy (lane->tail, data + len - rem, rem);
+  lane->tail[rem] = 0x80;
+
+  for (x = 0; x < 8; x++)
+    lane->tail[lane->tail_blocks * SHA256_BLOCK_LEN - 1 - x] = bits >> (8 * x);
+
+  for (x = 0; x < 8; x++)
+    state[x * lanes + l] = H0[x];
+}
+
+void
+sha256_mb (const uint8_t *const *data, const size_t *len,
+           uint8_t (*digest)[SHA256_DIGEST_LEN], size_t n)
+{
+  uint32_t state[8 * SHA256_MB_MAX_LANES];
+  const uint8_t *blocks[SHA256_MB_MAX_LANES];
+  struct lane lanes[SHA256_MB_MAX_LANES];
+  bool active[SHA256_MB_MAX_LANES];
+  unsigned int num_lanes = 0;
+  unsigned int num_active = 0;
+  unsigned int l = 0;
+  size_t next = 0;
+  int x = 0;
+
+  assert (NULL != data || 0 == n);
+  assert (NULL != len || 0 == n);
+  assert (NULL != digest || 0 == n);
+
+  pthread_once (&engine_once, select_engine);
+
+  if (NULL == engine->blocks)
+    {
+      for (next = 0; next < n; next++)
+        sha256 (data[next], len[next], digest[next]);
+      return;
+    }
+
+  num_lanes = engine->lanes;
+
+  for (l = 0; l < num_lanes; l++)
+    {
+      active[l] = next < n;
+
+      if (active[l])
+        {
+          start_lane (&lanes[l], state, num_lanes, l, next, len[next],
+                      data[next]);
+          next++;
+          num_active++;
+        }
+    }
+
+  while (num_active > 0)
+    {
+      for (l = 0; l < num_lanes; l++)
+        {
+          struct lane *lane = &lanes[l];
+
+          if (!active[l])
+            blocks[l] = idle_block;
+          else if (lane->offset + SHA256_BLOCK_LEN <= len[lane->job])
+            blocks[l] = data[lane->job] + lane->offset;
+          else
+            blocks[l] = lane->tail + lane->tail_done * SHA256_BLOCK_LEN;
+        }
+
+      engine->blocks (state, blocks);
+
+      for (l = 0; l < num_lanes; l++)
+        {
+          struct lane *lane = &lanes[l];
+
+          if (!active[l])
+            continue;
+
+          if (lane->offset + SHA256_BLOCK_LEN <= len[lane->job])
+            lane->offset += SHA256_BLOCK_LEN;
+          else if (++lane->tail_done == lane->tail_blocks)
+            {
+              /* Done, write the digest and start the next message */
+              for (x = 0; x < 8; x++)
+                {
+                  uint32_t word = state[x * num_lanes + l];
+
+                  digest[lane->job][4 * x] = word >> 24;
+                  digest[lane->job][4 * x + 1] = word >> 16;
+                  digest[lane->job][4 * x + 2] = word >> 8;
+                  digest[lane->job][4 * x + 3] = word;
+                }
+
+              if (next < n)
+                {
+                  start_lane (lane, state, num_lanes, l, next, len[next],
+                              data[next]);
+                  next++;
+                }
+              else
+                {
+                  active[l] = false;
+                  num_active--;
+                }
+            }
+        }
+    }
+}
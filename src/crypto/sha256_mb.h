@@ -0,0 +1,76 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SHA256_MB_H
+#define SHA256_MB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sha256.h"
+
+/* Forces a multi-buffer engine by name, "none" disables it */
+#define SHA256_MB_ENGINE_ENV "ECLET_SHA256_MB_ENGINE"
+
+/* The most lanes any engine has */
+#define SHA256_MB_MAX_LANES 16
+
+/**
+ * Hash independent messages side by side, one per SIMD lane.  Short
+ * messages are where this pays off: a single message is one long
+ * dependency chain that leaves the vector units idle.
+ *
+ * @param data The messages
+ * @param len The length of each message
+ * @param digest Filled with each message's 32 byte digest
+ * @param n The number of messages
+ */
+void sha256_mb (const uint8_t *const *data, const size_t *len,
+                uint8_t (*digest)[SHA256_DIGEST_LEN], size_t n);
+
+/**
+ * The multi-buffer engine in use.  On first use the widest one the
+ * CPU supports is chosen, unless it would be slower than the single
+ * buffer engine (SHA extensions beat four lanes of SSE2), or the
+ * ECLET_SHA256_MB_ENGINE environment variable says otherwise.
+ *
+ * @return "avx512", "avx2", "sse2", "generic" or "none"
+ */
+const char * sha256_mb_engine (void);
+
+/**
+ * The number of messages hashed at once.
+ *
+ * @return The lane count, or 1 when multi-buffer hashing is off and
+ * sha256_mb falls back to one message at a time.
+ */
+unsigned int sha256_mb_lanes (void);
+
+/**
+ * Use the named engine from now on.
+ *
+ * @param name The engine's name, as sha256_mb_engine returns it
+ *
+ * @return false if the engine is unknown or this CPU lacks it
+ */
+bool sha256_mb_set_engine (const char *name);
+
+#endif /* SHA256_MB_H */
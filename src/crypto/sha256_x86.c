@@ -0,0 +1,151 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file   sha256_x86.c
+ *
+ * @brief  SHA256 with the x86 SHA extensions (SHA-NI), plus CPUID
+ * feature detection.  Built on every architecture; elsewhere the
+ * detection simply reports no support.
+ */
+
+#include <assert.h>
+
+#include "sha256_engines.h"
+
+#if defined (__x86_64__) || defined (__i386__)
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+#define CPUID_1_ECX_SSSE3 (1 << 9)
+#define CPUID_1_ECX_SSE41 (1 << 19)
+#define CPUID_7_EBX_SHA (1 << 29)
+
+static bool
+cpuid_leaf (unsigned int leaf, unsigned int *ebx, unsigned int *ecx)
+{
+  unsigned int eax = 0, edx = 0;
+
+  if (__get_cpuid_max (0, NULL) < leaf)
+    return false;
+
+  __cpuid_count (leaf, 0, eax, *ebx, *ecx, edx);
+
+  return true;
+}
+
+bool
+sha256_have_shani (void)
+{
+  unsigned int ebx1 = 0, ecx1 = 0, ebx7 = 0, ecx7 = 0;
+
+  return cpuid_leaf (1, &ebx1, &ecx1) && cpuid_leaf (7, &ebx7, &ecx7) &&
+    (ecx1 & CPUID_1_ECX_SSSE3) && (ecx1 & CPUID_1_ECX_SSE41) &&
+    (ebx7 & CPUID_7_EBX_SHA);
+}
+
+/* Each iteration of the round loop below does four rounds.  The
+   message schedule is kept as four vectors of four words, W[i % 4]
+   holding the words for rounds 4i to 4i+3. */
+__attribute__ ((target ("sha,ssse3,sse4.1")))
+void
+sha256_blocks_shani (uint32_t *state, const uint8_t *data,
+                     size_t num_blocks)
+{
+  const __m128i BSWAP = _mm_set_epi64x (0x0c0d0e0f08090a0bULL,
+                                        0x0405060700010203ULL);
+  __m128i state0, state1, abef, cdgh, msg, tmp;
+  __m128i w[4];
+  int i = 0;
+
+  assert (NULL != state);
+
+  /* The instructions want the state as ABEF and CDGH */
+  tmp = _mm_shuffle_epi32 (_mm_loadu_si128 ((const __m128i *)&state[0]),
+                           0xB1);
+  state1 = _mm_shuffle_epi32 (_mm_loadu_si128 ((const __m128i *)&state[4]),
+                              0x1B);
+  state0 = _mm_alignr_epi8 (tmp, state1, 8);
+  state1 = _mm_blend_epi16 (state1, tmp, 0xF0);
+
+  while (num_blocks-- > 0)
+    {
+      abef = state0;
+      cdgh = state1;
+
+      for (i = 0; i < 4; i++)
+        w[i] = _mm_shuffle_epi8
+          (_mm_loadu_si128 ((const __m128i *)(data + 16 * i)), BSWAP);
+
+#pragma GCC unroll 16
+      for (i = 0; i < 16; i++)
+        {
+          msg = _mm_add_epi32
+            (w[i % 4], _mm_loadu_si128 ((const __m128i *)&SHA256_K[4 * i]));
+          state1 = _mm_sha256rnds2_epu32 (state1, state0, msg);
+
+          if (i >= 3 && i <= 14)
+            {
+              tmp = _mm_alignr_epi8 (w[i % 4], w[(i + 3) % 4], 4);
+              w[(i + 1) % 4] = _mm_add_epi32 (w[(i + 1) % 4], tmp);
+              w[(i + 1) % 4] = _mm_sha256msg2_epu32 (w[(i + 1) % 4],
+                                                     w[i % 4]);
+            }
+
+          msg = _mm_shuffle_epi32 (msg, 0x0E);
+          state0 = _mm_sha256rnds2_epu32 (state0, state1, msg);
+
+          if (i >= 1 && i <= 12)
+            w[(i + 3) % 4] = _mm_sha256msg1_epu32 (w[(i + 3) % 4], w[i % 4]);
+        }
+
+      state0 = _mm_add_epi32 (state0, abef);
+      state1 = _mm_add_epi32 (state1, cdgh);
+
+      data += 64;
+    }
+
+  /* Back to ABCD and EFGH */
+  tmp = _mm_shuffle_epi32 (state0, 0x1B);
+  state1 = _mm_shuffle_epi32 (state1, 0xB1);
+  state0 = _mm_blend_epi16 (tmp, state1, 0xF0);
+  state1 = _mm_alignr_epi8 (state1, tmp, 8);
+
+  _mm_storeu_si128 ((__m128i *)&state[0], state0);
+  _mm_storeu_si128 ((__m128i *)&state[4], state1);
+}
+
+#else
+
+bool
+sha256_have_shani (void)
+{
+  return false;
+}
+
+void
+sha256_blocks_shani (uint32_t *state, const uint8_t *data,
+                     size_t num_blocks)
+{
+  assert (false);
+}
+
+#endif
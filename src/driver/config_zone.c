@@ -23,481 +23,272 @@
 #include <stdio.h>
 #include <string.h>
 #include <libcryptoauth.h>
-#include <stdlib.h>
 
-struct slot_config make_ecc_key_slot_config ()
+/* Each byte of a slot config decodes on its own, so both are looked
+   up in tables built by the preprocessor, one entry per byte value */
+struct read_bits
 {
-  return make_slot_config (1,     /* External Signatures are Enabled */
-                           false, /* Check Only */
-                           false, /* Single Use */
-                           false, /* Encrypted Read */
-                           true,  /* Is secret */
-                           0,     /* Slot for encrypted writes*/
-                           true,  /* Derive Key also allows GenKy */
-                           NEVER);/* Write configuration */
-
-}
-
-struct slot_config make_slot_config (unsigned int read_key, bool check_only,
-                                     bool single_use, bool encrypted_read,
-                                     bool is_secret, unsigned int write_key,
-                                     bool derive_key,
-                                     enum WRITE_CONFIG write_config)
+  uint8_t read_key;
+  bool check_only;
+  bool single_use;
+  bool encrypted_read;
+  bool is_secret;
+};
+
+struct write_bits
 {
+  uint8_t write_key;
+  bool derive_key;
+  uint8_t write_config;         /**< enum WRITE_CONFIG */
+};
+
+#define READ_BITS(b)                                            \
+  { (b) & 15, 0 != ((b) & CHECK_ONLY_MASK),                     \
+      0 != ((b) & SINGLE_USE_MASK), 0 != ((b) & ENCRYPTED_READ_MASK), \
+      0 != ((b) & IS_SECRET_MASK) }
+
+/* Any bit above the write key but the encrypt bit means never */
+#define WRITE_BITS(b)                                                   \
+  { (b) & 15, 0 != ((b) & WRITE_CONFIG_DERIVEKEY_MASK),                 \
+      0 == ((b) & ~15) ? ALWAYS :                                       \
+      0 != ((b) & WRITE_CONFIG_ENCRYPT_MASK) ? ENCRYPT : NEVER }
+
+#define BITS4(f, b) f (b), f ((b) + 1), f ((b) + 2), f ((b) + 3)
+#define BITS16(f, b) BITS4 (f, b), BITS4 (f, (b) + 4), BITS4 (f, (b) + 8), \
+    BITS4 (f, (b) + 12)
+#define BITS64(f, b) BITS16 (f, b), BITS16 (f, (b) + 16),       \
+    BITS16 (f, (b) + 32), BITS16 (f, (b) + 48)
+#define BITS256(f) BITS64 (f, 0), BITS64 (f, 64), BITS64 (f, 128), \
+    BITS64 (f, 192)
+
+static const struct read_bits READ_TABLE[256] = { BITS256 (READ_BITS) };
+static const struct write_bits WRITE_TABLE[256] = { BITS256 (WRITE_BITS) };
+
+/**
+ * Decode a slot config from its read byte, the first on the device,
+ * and its write byte.
+ */
+static struct slot_config
+decode_slot_config (uint8_t read_byte, uint8_t write_byte)
+{
+  const struct read_bits *r = &READ_TABLE[read_byte];
+  const struct write_bits *w = &WRITE_TABLE[write_byte];
   struct slot_config s;
 
-  assert (read_key < MAX_SLOTS);
-  assert (write_key < MAX_SLOTS);
-
-  s.read_key = read_key;
-  s.check_only = check_only;
-  s.single_use = single_use;
-  s.encrypted_read = encrypted_read;
-  s.is_secret = is_secret;
-  s.write_key = write_key;
-  s.derive_key = derive_key;
-  s.write_config = write_config;
+  s.read_key = r->read_key;
+  s.check_only = r->check_only;
+  s.single_use = r->single_use;
+  s.encrypted_read = r->encrypted_read;
+  s.is_secret = r->is_secret;
+  s.write_key = w->write_key;
+  s.derive_key = w->derive_key;
+  s.write_config = w->write_config;
 
   return s;
-
-}
-
-void serialize_slot_config (struct slot_config *s, uint8_t *config)
-{
-  assert (NULL != s);
-  assert (NULL != config);
-
-  uint8_t *p = config;
-
-  /* Bit 0 is the right most bit */
-  p++;
-
-  const unsigned int MAX_KEYS = 16;
-  /* Place read key in the last four bits */
-  assert (s->read_key < MAX_KEYS);
-  assert (s->write_key < MAX_KEYS);
-
-  *p = s->read_key;
-
-  if (s->check_only)
-    {
-      *p |= CHECK_ONLY_MASK;
-      LCA_LOG (DEBUG, "Check only set on slot config");
-    }
-
-
-  if (s->single_use)
-    {
-      *p |= SINGLE_USE_MASK;
-      LCA_LOG (DEBUG, "Single use set on slot config");
-    }
-
-  if (s->encrypted_read)
-    {
-      *p |= ENCRYPTED_READ_MASK;
-      LCA_LOG (DEBUG, "Encrypted read set on slot conifg");
-    }
-
-  if (s->is_secret)
-    {
-      *p |= IS_SECRET_MASK;
-      LCA_LOG (DEBUG, "Is Secret set on slot config");
-    }
-
-  /* The first byte has now been set */
-  p--;
-
-  *p = s->write_key;
-
-  if (s->derive_key)
-    {
-      *p |= WRITE_CONFIG_DERIVEKEY_MASK;
-      LCA_LOG (DEBUG, "Derive Key set on slot config");
-    }
-
-  switch (s->write_config)
-    {
-    case ALWAYS:
-      *p |= WRITE_CONFIG_ALWAYS_MASK;
-      LCA_LOG (DEBUG, "Write config always set");
-      break;
-    case NEVER:
-      *p |= WRITE_CONFIG_NEVER_MASK;
-      LCA_LOG (DEBUG, "Write config NEVER set");
-      break;
-    case ENCRYPT:
-      *p |= WRITE_CONFIG_ENCRYPT_MASK;
-      LCA_LOG (DEBUG, "Write config ENCRYPT set");
-      break;
-    default:
-      assert (false);
-
-    }
-
-  /* slot configs are little endian */
-  uint8_t tmp = config[0];
-  config[0] = config[1];
-  config[1] = tmp;
-
-  LCA_LOG (DEBUG, "Slot Config set: %02x %02x", config[0], config[1] );
-
 }
 
 struct slot_config parse_slot_config (uint8_t *raw)
 {
   assert (NULL != raw);
-  struct slot_config parsed = {0};
-  uint8_t * ptr = &raw[1];
-
-  LCA_LOG (DEBUG, "*** PARSING SLOT CONFIG ***");
-  /* Start with the LSB */
-  const uint16_t READ_KEY_MASK = 15;
-
-  parsed.read_key = *ptr & READ_KEY_MASK;
-
-  if ((*ptr & CHECK_ONLY_MASK) == CHECK_ONLY_MASK)
-    {
-      parsed.check_only = true;
-      LCA_LOG (DEBUG, "Slot config Check only set");
-    }
-
-  if ((*ptr & SINGLE_USE_MASK) == SINGLE_USE_MASK)
-    {
-      parsed.single_use = true;
-      LCA_LOG (DEBUG, "Single use slot config set");
-    }
-
-  if ((*ptr & ENCRYPTED_READ_MASK) == ENCRYPTED_READ_MASK)
-    {
-      parsed.encrypted_read = true;
-      LCA_LOG (DEBUG, "Encrypted read slot config set");
-    }
-
-  if ((*ptr & IS_SECRET_MASK) == IS_SECRET_MASK)
-    {
-      parsed.is_secret = true;
-      LCA_LOG (DEBUG, "Is Secret slot config set");
-    }
-
-  /* Now parse the MSB */
-  const uint8_t WRITE_KEY_MASK = 15;
-  ptr = raw;
-
-  parsed.write_key = *ptr & WRITE_KEY_MASK;
-
-  LCA_LOG (DEBUG, "Slot config Write Key %u", parsed.write_key);
-
-  if ((*ptr & WRITE_CONFIG_DERIVEKEY_MASK) == WRITE_CONFIG_DERIVEKEY_MASK)
-    {
-      parsed.derive_key = true;
-      LCA_LOG (DEBUG, "Derive Key slot config set");
-    }
-
-  uint8_t write_config = *ptr & ~WRITE_KEY_MASK;
-
-  if (0 == (~7 & write_config))
-    {
-      parsed.write_config = ALWAYS;
-      LCA_LOG (DEBUG, "Slot Config ALWAYS set");
-    }
-  else if (WRITE_CONFIG_ENCRYPT_MASK == (write_config &
-                                         WRITE_CONFIG_ENCRYPT_MASK))
-    {
-      parsed.write_config = ENCRYPT;
-      LCA_LOG (DEBUG, "Slot Config ENCRYPT set");
-    }
-  else
-    {
-      parsed.write_config = NEVER;
-      LCA_LOG (DEBUG, "Slot Config NEVER set");
-    }
-
-  LCA_LOG (DEBUG, "*** END PARSING ***");
-
-  return parsed;
 
+  return decode_slot_config (raw[1], raw[0]);
 }
 
-uint8_t get_slot_addr (enum config_slots slot)
+void decode_slot_configs (const uint8_t *config, struct slot_config *slots)
 {
-  uint8_t addr;
-
-
-  /* Slot configurations start at address 0x05 */
-
-  switch (slot)
-    {
-
-    case slot0:
-      addr = 0x05;
-      break;
+  const uint8_t *p = config + CONFIG_SLOT_CONFIG;
+  unsigned int x = 0;
 
-    case slot2:
-      addr = 0x06;
-      break;
-
-    case slot4:
-      addr = 0x07;
-      break;
-
-    case slot6:
-      addr = 0x08;
-      break;
-
-    case slot8:
-      addr = 0x09;
-      break;
-
-    case slot10:
-      addr = 0x0A;
-      break;
-
-    case slot12:
-      addr = 0x0B;
-      break;
-
-    case slot14:
-      addr = 0x0C;
-      break;
-
-    default:
-      assert (false);
-
-    }
+  assert (NULL != config);
+  assert (NULL != slots);
 
-  return addr;
+  for (x = 0; x < MAX_NUM_DATA_SLOTS; x++, p += 2)
+    slots[x] = decode_slot_config (p[0], p[1]);
 }
 
-bool write_slot_configs (int fd, enum config_slots slot,
-                         struct slot_config *s1, struct slot_config *s2)
+const struct config_layout DEFAULT_CONFIG_LAYOUT =
+  {
+    /* I2C address, OTP mode and selector mode */
+    .i2c = { 0xC0, 0x00, 0xAA, 0x00 },
+
+    .slot_config = { ECC_KEY_SLOT_CONFIG, /* Slot 0 */
+                     ECC_KEY_SLOT_CONFIG, /* Slot 1 */
+                     ECC_KEY_SLOT_CONFIG, /* Slot 2 */
+                     ECC_KEY_SLOT_CONFIG, /* Slot 3 */
+                     ECC_KEY_SLOT_CONFIG, /* Slot 4 */
+                     ECC_KEY_SLOT_CONFIG, /* Slot 5 */
+                     ECC_KEY_SLOT_CONFIG, /* Slot 6 */
+                     ECC_KEY_SLOT_CONFIG, /* Slot 7 */
+                     /* Slot 8 is the always writable data slot */
+                     CLEAR_SLOT_CONFIG,
+                     ECC_KEY_SLOT_CONFIG, /* Slot 9 */
+                     ECC_KEY_SLOT_CONFIG, /* Slot 10 */
+                     ECC_KEY_SLOT_CONFIG, /* Slot 11 */
+                     ECC_KEY_SLOT_CONFIG, /* Slot 12 */
+                     ECC_KEY_SLOT_CONFIG, /* Slot 13 */
+                     ECC_KEY_SLOT_CONFIG, /* Slot 14 */
+                     ECC_KEY_SLOT_CONFIG }, /* Slot 15 */
+
+    /* Slot locked, then the temperature offset */
+    .slot_locked = { 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+
+    .key_config = { 0x33, 0x00, /* Slot 0, ECC Private Key */
+                    0x33, 0x00, /* Slot 1, ECC Private Key */
+                    0x33, 0x00, /* Slot 2, ECC Private Key */
+                    0x33, 0x00, /* Slot 3, ECC Private Key */
+                    0x33, 0x00, /* Slot 4, ECC Private Key */
+                    0x33, 0x00, /* Slot 5, ECC Private Key */
+                    0x33, 0x00, /* Slot 6, ECC Private Key */
+                    0x3C, 0x00, /* Slot 7, ECC Private Key */
+                    0x30, 0x00, /* Slot 8, Data or Public Key */
+                    0x33, 0x00, /* Slot 9, ECC Private Key */
+                    0x33, 0x00, /* Slot 10, ECC Private Key */
+                    0x33, 0x00, /* Slot 11, ECC Private Key */
+                    0x33, 0x00, /* Slot 12, ECC Private Key */
+                    0x33, 0x00, /* Slot 13, ECC Private Key */
+                    0x33, 0x00, /* Slot 14, ECC Private Key */
+                    0x33, 0x00 } /* Slot 15, ECC Private Key */
+  };
+
+void config_layout_apply (const struct config_layout *layout,
+                          uint8_t *config)
 {
+  assert (NULL != layout);
+  assert (NULL != config);
 
-  uint8_t addr = get_slot_addr (slot);
-  uint32_t to_send;
-  uint8_t *p = (uint8_t *)&to_send;
-  bool result = false;
-
-  assert (NULL != s1);
-  assert (NULL != s2);
-
-
-  serialize_slot_config (s1, p);
-  p += 2;
-  serialize_slot_config (s2, p);
-
-  result = write4 (fd, CONFIG_ZONE, addr, to_send);
-
-  return result;
-
-
+  memcpy (config + 4 * CONFIG_WORD_I2C, layout->i2c, sizeof (layout->i2c));
+  memcpy (config + 4 * CONFIG_WORD_SLOT_CONFIG, layout->slot_config,
+          sizeof (layout->slot_config));
+  memcpy (config + 4 * CONFIG_WORD_SLOT_LOCKED, layout->slot_locked,
+          sizeof (layout->slot_locked));
+  memcpy (config + 4 * CONFIG_WORD_KEY_CONFIG, layout->key_config,
+          sizeof (layout->key_config));
 }
 
-struct slot_config** build_slot_configs (void)
+/**
+ * Whether a whole block may be written at once.  The first block
+ * starts with the read only serial and revision numbers, and the
+ * third ends with UserExtra, Selector and the lock bytes, which Write
+ * can't change.
+ */
+static bool
+block_writable (unsigned int block)
 {
-  const unsigned int NUM_SLOTS = 16;
+  return 1 == block || 3 == block;
+}
 
-  struct slot_config **config = (struct slot_config **)
-    lca_malloc_wipe (NUM_SLOTS * sizeof(struct slot_config *));
+bool write_config_image (int fd, const uint8_t *current, const uint8_t *target)
+{
+  unsigned int block = 0, word = 0;
+  unsigned int writes = 0;
 
-  int x = 0;
+  assert (NULL != current);
+  assert (NULL != target);
 
-  for (x=0; x<NUM_SLOTS; x++)
+  for (block = 0; block < CONFIG_ZONE_LEN / ZONE_BLOCK_LEN; block++)
     {
-      config[x] = (struct slot_config *)
-        lca_malloc_wipe (sizeof (struct slot_config));
-    }
-
-  /* Set up each slot */
-
-  *config[0] =  make_ecc_key_slot_config ();
-
-  *config[1] =  make_ecc_key_slot_config ();
-
-  *config[2] =  make_ecc_key_slot_config ();
-
-  *config[3] =  make_ecc_key_slot_config ();
-
-  *config[4] =  make_ecc_key_slot_config ();
-
-  *config[5] =  make_ecc_key_slot_config ();
-
-  *config[6] =  make_ecc_key_slot_config ();
+      const unsigned int start = block * ZONE_BLOCK_LEN;
+      unsigned int differ = 0;
 
-  *config[7] =  make_ecc_key_slot_config ();
+      for (word = 0; word < ZONE_BLOCK_WORDS; word++)
+        if (0 != memcmp (current + start + 4 * word, target + start + 4 * word,
+                         4))
+          differ++;
 
-  /* Slot 8 is the always writable data slot */
-  *config[8] =  make_slot_config (0,     /* External Signatures are Enabled */
-                                  false, /* Check Only */
-                                  false, /* Single Use */
-                                  false, /* Encrypted Read */
-                                  false,  /* Is secret */
-                                  0,     /* Slot for encrypted writes*/
-                                  false,  /* Derive Key also allows GenKy */
-                                  ALWAYS);/* Write configuration */
+      if (0 == differ)
+        continue;
 
-  *config[9] =  make_ecc_key_slot_config ();
-
-  *config[10] =  make_ecc_key_slot_config ();
-
-  *config[11] =  make_ecc_key_slot_config ();
-
-  *config[12] =  make_ecc_key_slot_config ();
-
-  *config[13] =  make_ecc_key_slot_config ();
-
-  *config[14] =  make_ecc_key_slot_config ();
-
-  *config[15] =  make_ecc_key_slot_config ();
+      if (differ >= CONFIG_PROMOTE_WORDS && block_writable (block))
+        {
+          /* The words that already match are rewritten unchanged */
+          struct lca_octet_buffer to_write =
+            { (uint8_t *)target + start, ZONE_BLOCK_LEN };
 
-  return config;
+          if (!lca_write32_cmd (fd, CONFIG_ZONE, block * ZONE_BLOCK_WORDS,
+                                to_write, NULL))
+            return false;
 
+          writes++;
+          continue;
+        }
 
-}
+      for (word = 0; word < ZONE_BLOCK_WORDS; word++)
+        {
+          const unsigned int offset = start + 4 * word;
+          uint32_t to_send = 0;
 
-void free_slot_configs (struct slot_config **slots)
-{
-  assert (NULL != slots);
+          if (0 == memcmp (current + offset, target + offset, 4))
+            continue;
 
-  const unsigned int NUM_SLOTS = 16;
+          memcpy (&to_send, target + offset, sizeof (to_send));
 
-  int x = 0;
+          if (!write4 (fd, CONFIG_ZONE, offset / 4, to_send))
+            return false;
 
-  for (x=0; x<NUM_SLOTS; x++)
-    {
-      assert (NULL != slots[x]);
-      free (slots[x]);
+          writes++;
+        }
     }
 
-  free (slots);
+  LCA_LOG (DEBUG, "Config zone reached in %u writes", writes);
+
+  return true;
 }
 
-bool set_slot_locked_and_temp (int fd)
+bool write_config_layout (int fd, const struct config_layout *layout,
+                          uint8_t *written)
 {
+  uint8_t current[CONFIG_ZONE_LEN];
+  uint8_t target[CONFIG_ZONE_LEN];
 
-  uint8_t slot_locked[4] = { 0xFF, 0xFF, 0x00, 0x00};
-  uint8_t temp[4] = {0x00, 0x00, 0x00, 0x00};
-  uint8_t addr = 0x16;
+  assert (NULL != layout);
 
-  uint32_t to_write = 0;
+  if (!read_zone (fd, CONFIG_ZONE, current, sizeof (current)))
+    return false;
 
-  memcpy (&to_write, slot_locked, sizeof(slot_locked));
+  memcpy (target, current, sizeof (target));
+  config_layout_apply (layout, target);
 
-  bool result = write4 (fd, CONFIG_ZONE, addr, to_write);
-  if (result)
-    {
-      memcpy (&to_write, temp, sizeof(temp));
-      result = write4 (fd, CONFIG_ZONE, addr + 1, to_write);
-    }
+  if (!write_config_image (fd, current, target))
+    return false;
 
-  return result;
+  if (NULL != written)
+    memcpy (written, target, sizeof (target));
 
+  return true;
 }
 
-bool set_key_config (int fd)
+bool set_config_zone (int fd, const struct config_layout *layout,
+                      uint8_t *written)
 {
-  uint8_t key_config[32] = {0x33, 0x00, /* Slot 0, ECC Private Key */
-                            0x33, 0x00, /* Slot 1, ECC Private Key */
-                            0x33, 0x00, /* Slot 2, ECC Private Key */
-                            0x33, 0x00, /* Slot 3, ECC Private Key */
-                            0x33, 0x00, /* Slot 4, ECC Private Key */
-                            0x33, 0x00, /* Slot 5, ECC Private Key */
-                            0x33, 0x00, /* Slot 6, ECC Private Key */
-                            0x3C, 0x00, /* Slot 7, ECC Private Key */
-                            0x33, 0x00, /* Slot 8, User Data */
-                            0x33, 0x00, /* Slot 9, ECC Private Key */
-                            0x33, 0x00, /* Slot 10, ECC Private Key */
-                            0x33, 0x00, /* Slot 11, ECC Private Key */
-                            0x33, 0x00, /* Slot 12, ECC Private Key */
-                            0x33, 0x00, /* Slot 13, ECC Private Key */
-                            0x33, 0x00, /* Slot 14, ECC Private Key */
-                            0x33, 0x00 }; /* Slot 15, ECC Private Key */
-
-  uint8_t key_config_addr = 0x18;
-
-  struct lca_octet_buffer to_write = { key_config, sizeof(key_config)};
-
-  return lca_write32_cmd (fd, CONFIG_ZONE, key_config_addr, to_write, NULL);
-
-}
-
-
-bool set_config_zone (int fd)
-{
-  bool result = false;
-
   if (lca_is_config_locked (fd))
     return true;
 
-  enum config_slots slots[CONFIG_SLOTS_NUM_SLOTS] = {slot0, slot2, slot4,
-                                                     slot6, slot8, slot10,
-                                                     slot12, slot14};
-
-  struct slot_config ** configs = build_slot_configs();
-
-  int x = 0;
-
-  const uint8_t I2C_ADDR_OTP_MODE_SELECTOR_MODE [] =
-    { 0xC0, 0x00, 0xAA, 0x00 };
-  const uint8_t I2C_ADDR_ETC_WORD = 0x04;
-
-  uint32_t to_send = 0;
-  memcpy (&to_send, &I2C_ADDR_OTP_MODE_SELECTOR_MODE, sizeof (to_send));
-
-  result = write4 (fd, CONFIG_ZONE, I2C_ADDR_ETC_WORD,to_send);
-
-  for (x=0; x < CONFIG_SLOTS_NUM_SLOTS && result; x++)
-    {
-      int slot = 2 * x;
-      result = write_slot_configs (fd, slots[x],
-                                   configs[slot], configs[slot+1]);
-    }
-
-  free_slot_configs (configs);
+  if (NULL == layout)
+    layout = &DEFAULT_CONFIG_LAYOUT;
 
-  /* Set the Slot Locked and Temperature offset */
-  if (result)
-    {
-      if ((result = set_slot_locked_and_temp (fd)))
-        {
-          LCA_LOG (DEBUG, "slot lock config passed");
-          result = set_key_config (fd);
-        }
-    }
-
-  return result;
+  return write_config_layout (fd, layout, written);
 
 }
 
 struct slot_config get_slot_config (int fd, unsigned int slot)
 {
-  const unsigned int NUM_SLOTS = 16;
-
-  assert (slot < NUM_SLOTS);
-
-  uint32_t data = 0;
-  uint8_t *p = (uint8_t *)&data;
+  const unsigned int offset = CONFIG_SLOT_CONFIG + 2 * slot;
+  const unsigned int block = offset / ZONE_BLOCK_LEN;
+  struct lca_octet_buffer data = {0,0};
+  struct slot_config parsed;
 
-  const uint32_t OFFSET_TO_SLOT_CONFIGS = 5;
-  uint8_t addr = slot;
+  assert (slot < MAX_NUM_DATA_SLOTS);
 
-  if (slot % 2 != 0)
-    addr -= 1;
+  /* A slot's two bytes never straddle a block */
+  data = read32 (fd, CONFIG_ZONE, block * ZONE_BLOCK_WORDS);
+  assert (NULL != data.ptr);
 
-  addr += OFFSET_TO_SLOT_CONFIGS;
+  parsed = decode_slot_config (data.ptr[offset % ZONE_BLOCK_LEN],
+                               data.ptr[offset % ZONE_BLOCK_LEN + 1]);
 
-  assert (read4 (fd, CONFIG_ZONE, addr, &data));
-
-  printf ("Raw data %x\n", data);
-
-  if (slot % 2 != 0)
-    {
-      data &= 0xFFFF;
-    }
-  else
-    data = data >> 16;
-
-  return parse_slot_config (p);
+  lca_free_octet_buffer (data);
 
+  return parsed;
 
 }
 
@@ -518,3 +309,37 @@ bool cmp_slot_config (struct slot_config lhs, struct slot_config rhs)
   return result;
 
 }
+
+bool read_zone (int fd, enum DATA_ZONE zone, uint8_t *buf, unsigned int len)
+{
+  unsigned int block = 0;
+
+  assert (NULL != buf);
+  assert (0 == len % ZONE_BLOCK_LEN);
+
+  for (block = 0; block * ZONE_BLOCK_LEN < len; block++)
+    {
+      struct lca_octet_buffer data = read32 (fd, zone,
+                                             block * ZONE_BLOCK_WORDS);
+
+      if (NULL == data.ptr)
+        return false;
+
+      memcpy (buf + block * ZONE_BLOCK_LEN, data.ptr, ZONE_BLOCK_LEN);
+      lca_free_octet_buffer (data);
+    }
+
+  return true;
+}
+
+enum DEVICE_STATE config_zone_state (const uint8_t *config)
+{
+  assert (NULL != config);
+
+  if (CONFIG_UNLOCKED == config[CONFIG_LOCK_CONFIG])
+    return STATE_FACTORY;
+  else if (CONFIG_UNLOCKED == config[CONFIG_LOCK_VALUE])
+    return STATE_INITIALIZED;
+  else
+    return STATE_PERSONALIZED;
+}
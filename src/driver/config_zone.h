@@ -33,6 +33,60 @@
 #define ENCRYPTED_READ_MASK 0b01000000
 #define IS_SECRET_MASK      0b10000000
 
+/* Zone sizes and the 32 byte blocks they are read in */
+#define CONFIG_ZONE_LEN 128
+#define OTP_ZONE_LEN 64
+#define ZONE_BLOCK_LEN 32
+#define ZONE_BLOCK_WORDS 8          /**< Word address step per block */
+
+/* Byte offsets in the config zone */
+#define CONFIG_SLOT_CONFIG 20       /**< Two bytes per slot */
+#define CONFIG_LOCK_VALUE 86        /**< Data and OTP zone lock */
+#define CONFIG_LOCK_CONFIG 87       /**< Config zone lock */
+#define CONFIG_KEY_CONFIG 96        /**< Two bytes per slot */
+#define CONFIG_UNLOCKED 0x55
+
+/* Word addresses of what personalization writes */
+#define CONFIG_WORD_I2C 0x04
+#define CONFIG_WORD_SLOT_CONFIG 0x05
+#define CONFIG_WORD_SLOT_LOCKED 0x16
+#define CONFIG_WORD_KEY_CONFIG 0x18
+
+/* Words to change in a block before it is written whole */
+#define CONFIG_PROMOTE_WORDS 4
+
+/* Serialize a slot config at compile time: the read byte first, as
+   the device stores it, then the write byte */
+#define SLOT_CONFIG(read_key, check_only, single_use, encrypted_read,   \
+                    is_secret, write_key, derive_key, write_mask)       \
+  (read_key) | ((check_only) ? CHECK_ONLY_MASK : 0) |                   \
+  ((single_use) ? SINGLE_USE_MASK : 0) |                                \
+  ((encrypted_read) ? ENCRYPTED_READ_MASK : 0) |                        \
+  ((is_secret) ? IS_SECRET_MASK : 0),                                   \
+    (write_key) | ((derive_key) ? WRITE_CONFIG_DERIVEKEY_MASK : 0) |    \
+    (write_mask)
+
+/* An ECC private key: external signatures enabled, secret, GenKey
+   allowed and never written */
+#define ECC_KEY_SLOT_CONFIG                                             \
+  SLOT_CONFIG (1, false, false, false, true, 0, true, WRITE_CONFIG_NEVER_MASK)
+
+/* Read and written in the clear: data, or a public key for Verify */
+#define CLEAR_SLOT_CONFIG                                               \
+  SLOT_CONFIG (0, false, false, false, false, 0, false,                 \
+               WRITE_CONFIG_ALWAYS_MASK)
+
+/* KeyConfig bits, in the first byte of each slot's pair */
+#define KEY_CONFIG_PRIVATE_MASK 0b00000001
+#define KEY_CONFIG_KEY_TYPE(b) (((b) >> 2) & 7)
+#define KEY_TYPE_P256 4
+
+/* First KeyConfig bytes of the slot kinds personalization uses, all
+   lockable */
+#define KEY_CONFIG_P256_PRIVATE 0x33  /**< With public key generation */
+#define KEY_CONFIG_P256_PUBLIC 0x30
+#define KEY_CONFIG_DATA 0x3C          /**< Not an ECC key */
+
 
 /// Enumerations for the Write config options
 enum WRITE_CONFIG
@@ -43,22 +97,6 @@ enum WRITE_CONFIG
   };
 
 
-/* Enumerations for the Slot configuration areas.  Two slots must be
-   written together (as a 4 byte word).
-*/
-enum config_slots
-  {
-    slot0 = 0,
-    slot2,
-    slot4,
-    slot6,
-    slot8,
-    slot10,
-    slot12,
-    slot14,
-    CONFIG_SLOTS_NUM_SLOTS
-  };
-
 struct slot_config
 {
   unsigned int read_key;        /**< Slot of key to used for encrypted
@@ -90,45 +128,11 @@ struct slot_config
 };
 
 
-/**
- * Populate the slot config structure
- *
- * @param read_key Set to true if the slot will be used for encrypted reads.
- * @param check_only Set to true to limit slot to CheckMac and GenDig
- * followed by CheckMac
- * @param single_use Set to true to limit the number of times the key
- * can be used (based on UseFlag)
- * @param encrypted_read Set to true to require encrypted reads
- * @param is_secret Set to true to require encrypted reads
- * @param write_key The key slot to be used to decrypt encrypted writes
- * @param write_config The write config options
- *
- * @return
- */
-struct slot_config make_slot_config (unsigned int read_key, bool check_only,
-                                     bool single_use, bool encrypted_read,
-                                     bool is_secret, unsigned int write_key,
-                                     bool derive_key,
-                                     enum WRITE_CONFIG write_config);
-
-/**
- * Write the Configuration slots.  The minimum write length is four
- * bytes therefore this function must write two slot configurations at
- * one time.
- *
- * @param fd The open file descriptor.
- * @param slot The first (even) slot to which to write
- * @param s1 The configuration data for the first slot
- * @param s2 The configuration data for the second slot
- *
- * @return true if the write sucseeds, otherwise false.
- */
-bool write_slot_configs (int fd, enum config_slots slot,
-                         struct slot_config *s1, struct slot_config *s2);
-
 /**
  * Retrieve the slot configuration for the given slot.  The slot
- * configuration contains details on how the key can be used.
+ * configuration contains details on how the key can be used.  This
+ * reads the 32 byte block holding it.  For more than one slot, read
+ * the zone with read_zone and use decode_slot_configs.
  *
  * @param fd The open file descriptor
  * @param slot The slot (0 - 15) to retrieve.
@@ -138,23 +142,36 @@ bool write_slot_configs (int fd, enum config_slots slot,
 struct slot_config get_slot_config (int fd, unsigned int slot);
 
 /**
- * Converts the slot ID into an address
+ * Decode every slot configuration of a config zone read with
+ * read_zone.
+ *
+ * @param config The CONFIG_ZONE_LEN byte config zone
+ * @param slots Filled with MAX_NUM_DATA_SLOTS slot configurations
+ */
+void decode_slot_configs (const uint8_t *config, struct slot_config *slots);
+
+/**
+ * Read a whole zone in 32 byte blocks.
  *
- * @param slot The slot to use
+ * @param fd The open file descriptor
+ * @param zone CONFIG_ZONE or OTP_ZONE
+ * @param buf Filled with the zone, CONFIG_ZONE_LEN or OTP_ZONE_LEN
+ * bytes
+ * @param len The zone's length
  *
- * @return The mapped address
+ * @return false if a block can't be read
  */
-uint8_t get_slot_addr (enum config_slots slot);
+bool read_zone (int fd, enum DATA_ZONE zone, uint8_t *buf, unsigned int len);
 
 /**
- * Convert the slot config structure to the ready-to-send bit order.
+ * The device state from a config zone read with read_zone, which
+ * saves reading the lock bytes again.
  *
- * @param s The slot config to serialize
- * @param slot The pointer to two bytes which will be filled in with
- * the appropriate slot config representation
+ * @param config The config zone
  *
+ * @return The state
  */
-void serialize_slot_config (struct slot_config *s, uint8_t *slot);
+enum DEVICE_STATE config_zone_state (const uint8_t *config);
 
 /**
  * Parse the raw bit representation of the slot config to the
@@ -166,21 +183,70 @@ void serialize_slot_config (struct slot_config *s, uint8_t *slot);
  */
 struct slot_config parse_slot_config (uint8_t *raw);
 
+/* The config zone words personalization writes, each already in the
+   device's byte order */
+struct config_layout
+{
+  uint8_t i2c[4];               /**< I2C address, OTP and selector mode */
+  uint8_t slot_config[32];      /**< Two bytes per slot */
+  uint8_t slot_locked[8];       /**< Slot locked, temperature offset */
+  uint8_t key_config[32];       /**< Two bytes per slot */
+};
+
+/* The layout every slot is personalized with unless told otherwise */
+extern const struct config_layout DEFAULT_CONFIG_LAYOUT;
+
 /**
- * Build the slot config attributes
+ * Write a layout over a config zone image.
  *
+ * @param layout The layout
+ * @param config The CONFIG_ZONE_LEN byte image to update
+ */
+void config_layout_apply (const struct config_layout *layout,
+                          uint8_t *config);
+
+/**
+ * Bring an unlocked config zone from one image to another with as
+ * few writes as possible.  Words that already match are skipped.
+ * When a block that can be written whole has CONFIG_PROMOTE_WORDS or
+ * more words to change, it is written in one 32 byte write instead.
  *
- * @return A malloc'd array of malloc'd slot config pointers, each set
- * appropriately.
+ * @param fd The open file descriptor
+ * @param current The config zone as read from the device
+ * @param target The config zone wanted
+ *
+ * @return true if every write succeeded
+ */
+bool write_config_image (int fd, const uint8_t *current,
+                         const uint8_t *target);
+
+/**
+ * Write a layout to an unlocked config zone.  The zone is read once
+ * and only what differs is written, so a device left part way
+ * through personalization is finished rather than rewritten.
+ *
+ * @param fd The open file descriptor
+ * @param layout The layout
+ * @param written If not NULL, filled with the CONFIG_ZONE_LEN byte
+ * zone as it now stands, which is what the lock CRC covers
+ *
+ * @return true if every write succeeded
  */
-struct slot_config** build_slot_configs (void);
+bool write_config_layout (int fd, const struct config_layout *layout,
+                          uint8_t *written);
 
 /**
- * Frees the slot config array
+ * Write a layout, unless the config zone is already locked.
+ *
+ * @param fd The open file descriptor
+ * @param layout The layout, or NULL for DEFAULT_CONFIG_LAYOUT
+ * @param written As for write_config_layout, left untouched if the
+ * zone is locked
  *
- * @param slots The malloc'd slot config array form build_slot_configs
+ * @return true if the zone is locked or was written
  */
-void free_slot_configs (struct slot_config **slots);
+bool set_config_zone (int fd, const struct config_layout *layout,
+                      uint8_t *written);
 
 /**
  * Returns true if the slot configs match
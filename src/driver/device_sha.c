@@ -0,0 +1,127 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "device_sha.h"
+
+static bool
+sha_command (int fd, uint8_t mode, uint8_t *block, uint8_t *rsp,
+             unsigned int rsp_len)
+{
+  uint8_t param2[2] = {0};
+  struct Command_ATSHA204 c = lca_make_command ();
+
+  lca_set_opcode (&c, SHA_OPCODE);
+  lca_set_param1 (&c, mode);
+  lca_set_param2 (&c, param2);
+  lca_set_data (&c, block, NULL != block ? SHA_BLOCK_LEN : 0);
+  lca_set_execution_time (&c, 0, SHA_EXEC_TIME_NS);
+
+  if (RSP_SUCCESS == lca_process_command (fd, &c, rsp, rsp_len))
+    return true;
+
+  LCA_LOG (DEBUG, "SHA command (mode %u) failed", mode);
+  return false;
+}
+
+/**
+ * Fill buf from the descriptor, short only at the end of the input.
+ *
+ * @return The number of bytes read or -1 on error
+ */
+static ssize_t
+read_block (int in, uint8_t *buf, size_t len)
+{
+  size_t total = 0;
+  ssize_t n = 0;
+
+  while (total < len)
+    {
+      if ((n = read (in, buf + total, len - total)) == 0)
+        break;
+
+      if (n < 0)
+        {
+          if (EINTR == errno)
+            continue;
+
+          return -1;
+        }
+
+      total += n;
+    }
+
+  return total;
+}
+
+struct lca_octet_buffer
+device_sha256_fd (int fd, int in, uint64_t *len)
+{
+  struct lca_octet_buffer digest = {0,0};
+  uint8_t block[2 * SHA_BLOCK_LEN];
+  uint8_t rsp[32];
+  uint64_t total = 0;
+  ssize_t n = 0;
+  unsigned int num_blocks = 0;
+  unsigned int x = 0;
+
+  if (!sha_command (fd, SHA_MODE_START, NULL, rsp, 1))
+    return digest;
+
+  while ((n = read_block (in, block, SHA_BLOCK_LEN)) == SHA_BLOCK_LEN)
+    {
+      if (!sha_command (fd, SHA_MODE_COMPUTE, block, rsp, sizeof (rsp)))
+        return digest;
+
+      total += n;
+    }
+
+  if (n < 0)
+    {
+      perror ("Failed to read input");
+      return digest;
+    }
+
+  /* The device leaves padding to the host */
+  total += n;
+  memset (block + n, 0, sizeof (block) - n);
+  block[n] = 0x80;
+  num_blocks = n + 9 > SHA_BLOCK_LEN ? 2 : 1;
+
+  for (x = 0; x < 8; x++)
+    block[num_blocks * SHA_BLOCK_LEN - 1 - x] = (total * 8) >> (8 * x);
+
+  for (x = 0; x < num_blocks; x++)
+    if (!sha_command (fd, SHA_MODE_COMPUTE, block + x * SHA_BLOCK_LEN, rsp,
+                      sizeof (rsp)))
+      return digest;
+
+  digest = lca_make_buffer (sizeof (rsp));
+  memcpy (digest.ptr, rsp, sizeof (rsp));
+
+  if (NULL != len)
+    *len = total;
+
+  return digest;
+}
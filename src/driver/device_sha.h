@@ -0,0 +1,52 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DEVICE_SHA_H
+#define DEVICE_SHA_H
+
+#include <stdint.h>
+#include <libcryptoauth.h>
+
+#define SHA_OPCODE 0x47
+#define SHA_MODE_START 0x00         /**< Initialize the SHA engine */
+#define SHA_MODE_COMPUTE 0x01       /**< Hash one padded 64 byte block */
+
+/* Maximum execution time of the SHA command, from the datasheet */
+#define SHA_EXEC_TIME_NS 9000000
+
+#define SHA_BLOCK_LEN 64
+
+/**
+ * SHA256 everything read from a descriptor with the device's SHA
+ * engine.  The host pads the message and sends it one block per
+ * command.  The engine keeps its state only while the device is
+ * awake, so a message that takes longer than the watchdog allows
+ * fails rather than producing a wrong digest.
+ *
+ * @param fd The open device
+ * @param in The descriptor to hash, read to the end
+ * @param len If not NULL, set to the number of bytes hashed
+ *
+ * @return The 32 byte digest, which must be freed, or a NULL buffer
+ * on a read or device error.
+ */
+struct lca_octet_buffer device_sha256_fd (int fd, int in, uint64_t *len);
+
+#endif /* DEVICE_SHA_H */
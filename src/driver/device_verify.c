@@ -0,0 +1,154 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "device_verify.h"
+
+void
+device_verify_prepare (struct device_verify_packet *p, const uint8_t *pub_key,
+                       const uint8_t *signature, const uint8_t *digest)
+{
+  assert (NULL != p);
+  assert (0x04 == pub_key[0]);
+
+  memcpy (p->nonce, digest, sizeof (p->nonce));
+  memcpy (p->verify, signature, 64);
+
+  /* The ECC108 doesn't use the leading uncompressed point format tag */
+  memcpy (p->verify + 64, pub_key + 1, 64);
+  p->key_slot = -1;
+}
+
+void
+device_verify_prepare_stored (struct device_verify_packet *p,
+                              unsigned int slot, const uint8_t *signature,
+                              const uint8_t *digest)
+{
+  assert (NULL != p);
+  assert (slot < MAX_NUM_DATA_SLOTS);
+
+  memcpy (p->nonce, digest, sizeof (p->nonce));
+  memcpy (p->verify, signature, 64);
+  p->key_slot = slot;
+}
+
+static enum LCA_STATUS_RESPONSE
+verify_command (int fd, uint8_t opcode, uint8_t mode, uint16_t key_id,
+                uint8_t *data, uint8_t len, unsigned long exec_time_ns)
+{
+  uint8_t param2[2] = { key_id & 0xFF, key_id >> 8 };
+  uint8_t rsp = 0xFF;
+  struct Command_ATSHA204 c = lca_make_command ();
+  enum LCA_STATUS_RESPONSE status;
+
+  lca_set_opcode (&c, opcode);
+  lca_set_param1 (&c, mode);
+  lca_set_param2 (&c, param2);
+  lca_set_data (&c, data, len);
+  lca_set_execution_time (&c, 0, exec_time_ns);
+
+  status = lca_process_command (fd, &c, &rsp, sizeof (rsp));
+
+  /* Both commands answer with a single status byte */
+  if (RSP_SUCCESS == status && 0 != rsp)
+    status = rsp;
+
+  return status;
+}
+
+bool
+device_verify_load_key (int fd, unsigned int slot, const uint8_t *pub_key)
+{
+  uint8_t padded[3 * 32] = {0};
+  unsigned int block = 0;
+
+  assert (NULL != pub_key);
+  assert (slot >= PUB_KEY_MIN_SLOT && slot < MAX_NUM_DATA_SLOTS);
+
+  if (0x04 != pub_key[0])
+    return false;
+
+  memcpy (padded + 4, pub_key + 1, 32);
+  memcpy (padded + 4 + 32 + 4, pub_key + 1 + 32, 32);
+
+  /* The library's write takes an 8 bit address, which can't name the
+     blocks past the first, so the Write commands are built here */
+  for (block = 0; block * 32 < PUB_KEY_SLOT_LEN; block++)
+    {
+      uint8_t param2[2] = { slot << 3, block };
+      uint8_t rsp = 0xFF;
+      struct Command_ATSHA204 c = lca_make_command ();
+
+      lca_set_opcode (&c, WRITE_OPCODE);
+      lca_set_param1 (&c, WRITE_ZONE_DATA_32);
+      lca_set_param2 (&c, param2);
+      lca_set_data (&c, padded + 32 * block, 32);
+      lca_set_execution_time (&c, 0, WRITE_EXEC_TIME_NS);
+
+      if (RSP_SUCCESS != lca_process_command (fd, &c, &rsp, sizeof (rsp)) ||
+          0 != rsp)
+        {
+          LCA_LOG (DEBUG, "Write of slot %u block %u failed", slot, block);
+          return false;
+        }
+    }
+
+  return true;
+}
+
+bool
+device_verify_send (int fd, struct device_verify_packet *p)
+{
+  enum LCA_STATUS_RESPONSE status = RSP_COMM_ERROR;
+  unsigned int attempt = 0;
+  bool stored = false;
+
+  assert (NULL != p);
+
+  stored = p->key_slot >= 0;
+
+  for (attempt = 0; attempt < 2; attempt++)
+    {
+      if (RSP_SUCCESS != verify_command (fd, NONCE_OPCODE,
+                                         NONCE_MODE_PASSTHROUGH, 0,
+                                         p->nonce, sizeof (p->nonce),
+                                         NONCE_EXEC_TIME_NS))
+        continue;
+
+      /* A stored key is named by its slot and only R, S are sent */
+      if (stored)
+        status = verify_command (fd, VERIFY_OPCODE, VERIFY_MODE_STORED,
+                                 p->key_slot, p->verify, 64,
+                                 VERIFY_EXEC_TIME_NS);
+      else
+        status = verify_command (fd, VERIFY_OPCODE, VERIFY_MODE_EXTERNAL,
+                                 VERIFY_KEY_P256, p->verify,
+                                 sizeof (p->verify), VERIFY_EXEC_TIME_NS);
+
+      if (RSP_SUCCESS == status || RSP_CHECKMAC_MISCOMPARE == status)
+        break;
+
+      LCA_LOG (DEBUG, "Verify command failed (0x%02X), resending", status);
+    }
+
+  return RSP_SUCCESS == status;
+}
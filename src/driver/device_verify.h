@@ -0,0 +1,115 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DEVICE_VERIFY_H
+#define DEVICE_VERIFY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <libcryptoauth.h>
+
+#define NONCE_OPCODE 0x16
+#define NONCE_MODE_PASSTHROUGH 0x03 /**< Load 32 bytes into TempKey as is */
+
+#define VERIFY_OPCODE 0x45
+#define VERIFY_MODE_STORED 0x00     /**< The public key is in KeyID's slot */
+#define VERIFY_MODE_EXTERNAL 0x02   /**< The public key is in the command */
+#define VERIFY_KEY_P256 0x0004      /**< KeyID is the curve in this mode */
+
+#define WRITE_OPCODE 0x12
+#define WRITE_ZONE_DATA_32 0x82     /**< A 32 byte block of the data zone */
+
+/* Maximum execution times, from the datasheet */
+#define NONCE_EXEC_TIME_NS 7000000
+#define VERIFY_EXEC_TIME_NS 58000000
+#define WRITE_EXEC_TIME_NS 26000000
+
+/* A public key in a slot is X and Y, each after four bytes of zero
+   padding, so only slots 8 and up are large enough */
+#define PUB_KEY_SLOT_LEN 72
+#define PUB_KEY_MIN_SLOT 8
+
+/* One signature check, ready to send.  Preparing it does everything
+   the host can do ahead of the device, so the device thread only
+   sends. */
+struct device_verify_packet
+{
+  uint8_t nonce[32];                /**< The digest, loaded into TempKey */
+  uint8_t verify[128];              /**< R, S then the public key X, Y */
+  int key_slot;                     /**< The stored key's slot, or -1
+                                       when the key is in verify */
+};
+
+/**
+ * Fill a packet.
+ *
+ * @param p The packet
+ * @param pub_key The 65 byte uncompressed public key
+ * @param signature The 64 byte signature
+ * @param digest The 32 byte digest
+ */
+void
+device_verify_prepare (struct device_verify_packet *p, const uint8_t *pub_key,
+                       const uint8_t *signature, const uint8_t *digest);
+
+/**
+ * Fill a packet that verifies with the public key stored in a slot,
+ * so only the signature goes over the bus.
+ *
+ * @param p The packet
+ * @param slot The slot device_verify_load_key wrote the key to
+ * @param signature The 64 byte signature
+ * @param digest The 32 byte digest
+ */
+void
+device_verify_prepare_stored (struct device_verify_packet *p,
+                              unsigned int slot, const uint8_t *signature,
+                              const uint8_t *digest);
+
+/**
+ * Write a public key into a slot for stored key verification.  The
+ * slot's KeyConfig must describe a P256 public key and its SlotConfig
+ * must allow clear writes.
+ *
+ * @param fd The open device
+ * @param slot The slot, PUB_KEY_MIN_SLOT or above
+ * @param pub_key The 65 byte uncompressed public key
+ *
+ * @return true if every block was written, false without writing if
+ * the key lacks the 0x04 tag
+ */
+bool
+device_verify_load_key (int fd, unsigned int slot, const uint8_t *pub_key);
+
+/**
+ * Send a packet as a Nonce then Verify command pair.  The pair needs
+ * TempKey to survive between them, so if the device fell asleep in
+ * between, which shows up as an error instead of a miscompare, the
+ * pair is sent once more.
+ *
+ * @param fd The open device
+ * @param p The prepared packet
+ *
+ * @return true if the signature verified
+ */
+bool
+device_verify_send (int fd, struct device_verify_packet *p);
+
+#endif /* DEVICE_VERIFY_H */
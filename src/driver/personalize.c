@@ -78,15 +78,29 @@ crc_data_otp_zone (struct lca_octet_buffer data, struct lca_octet_buffer otp)
 
 }
 
-bool lock_config_zone (int fd, enum DEVICE_STATE state)
+bool lock_config_zone (int fd, enum DEVICE_STATE state, const uint8_t *config)
 {
 
   if (STATE_FACTORY != state)
     return true;
 
-  struct lca_octet_buffer config = get_config_zone (fd);
+  /* A wrong CRC leaves the zone unlocked, so it is safe to fall back
+     to reading what the device holds */
+  if (NULL != config &&
+      lock (fd, CONFIG_ZONE, lca_calculate_crc16 (config, CONFIG_ZONE_LEN)))
+    return true;
+
+  if (NULL != config)
+    LCA_LOG (DEBUG, "Config zone differs from what was written, reading it");
+
+  struct lca_octet_buffer zone = get_config_zone (fd);
+
+  if (NULL == zone.ptr)
+    return false;
+
+  uint16_t crc = lca_calculate_crc16 (zone.ptr, zone.len);
 
-  uint16_t crc = lca_calculate_crc16 (config.ptr, config.len);
+  lca_free_octet_buffer (zone);
 
   return lock (fd, CONFIG_ZONE, crc);
 
@@ -94,15 +108,18 @@ bool lock_config_zone (int fd, enum DEVICE_STATE state)
 
 
 enum DEVICE_STATE personalize (int fd, enum DEVICE_STATE goal,
-                               struct key_container *keys)
+                               struct key_container *keys,
+                               const struct config_layout *layout)
 {
 
   enum DEVICE_STATE state = lca_get_device_state (fd);
+  uint8_t config[CONFIG_ZONE_LEN];
 
   if (state >= goal)
     return state;
 
-  if (set_config_zone (fd) && lock_config_zone (fd, state))
+  if (set_config_zone (fd, layout, config) &&
+      lock_config_zone (fd, state, config))
     {
       state = STATE_INITIALIZED;
       assert (lca_get_device_state (fd) == state);
@@ -22,6 +22,7 @@
 #define PERSONALIZE_H
 
 #include <libcryptoauth.h>
+#include "config_zone.h"
 
 struct key_container
 {
@@ -52,13 +53,25 @@ void free_key_container (struct key_container *keys);
  * @param goal The desired device state
  * @param keys If keys are NULL, it will create random keys.
  * Otherwise burn in the keys provided.
+ * @param layout The config zone layout, NULL for DEFAULT_CONFIG_LAYOUT
  *
  * @return
  */
 enum DEVICE_STATE personalize (int fd, enum DEVICE_STATE goal,
-                               struct key_container *keys);
+                               struct key_container *keys,
+                               const struct config_layout *layout);
 
 
-
-bool lock_config_zone (int fd, enum DEVICE_STATE state);
+/**
+ * Lock the config zone of a device still in the factory state.
+ *
+ * @param fd The open file descriptor
+ * @param state The device state
+ * @param config The zone as set_config_zone left it, so the CRC needs
+ * no read back, or NULL to read it.  The zone is read anyway if the
+ * device rejects that CRC.
+ *
+ * @return true if the zone is locked
+ */
+bool lock_config_zone (int fd, enum DEVICE_STATE state, const uint8_t *config);
 #endif
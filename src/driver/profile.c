@@ -0,0 +1,310 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file   profile.c
+ *
+ * @brief  Personalization profiles: the config zone layout written as
+ * text, compiled once into a binary image that personalize --profile
+ * applies.
+ *
+ * Each profile line is one of:
+ *
+ *   i2c WORD                  I2C address, OTP and selector mode, 8 hex
+ *   temp WORD                 The word after SlotLocked, 8 hex
+ *   slot N private            A P-256 private key made with GenKey
+ *   slot N public             A P-256 public key for verify --stored-key
+ *   slot N data               Data read and written in the clear
+ *   slot N raw SLOT KEY       SlotConfig and KeyConfig, 4 hex each
+ *
+ * Any slot line may end in "locked", which clears the slot's
+ * SlotLocked bit.  Hex is in the device's byte order.  Anything after
+ * # is ignored.  A slot or word may be named once, and whatever isn't
+ * named keeps DEFAULT_CONFIG_LAYOUT.  Public keys only fit in slots 8
+ * and up.  Changing the I2C address moves the device once it is
+ * locked.
+ */
+
+#include <assert.h>
+#include <ctype.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "device_verify.h"
+#include "profile.h"
+#include <libcryptoauth.h>
+
+#define PROFILE_MAX_FIELDS 7
+
+/* SlotLocked is the first two bytes of its word, a clear bit locks
+   the slot, and the temperature offset word follows */
+#define SLOT_LOCKED_OFFSET 0
+#define TEMP_OFFSET 4
+
+static bool
+parse_hex (const char *arg, uint8_t *out, unsigned int len)
+{
+  unsigned int x = 0;
+
+  if (strlen (arg) != 2 * len)
+    return false;
+
+  for (x = 0; x < 2 * len; x++)
+    if (!isxdigit ((unsigned char)arg[x]))
+      return false;
+
+  for (x = 0; x < len; x++)
+    sscanf (arg + 2 * x, "%2hhx", &out[x]);
+
+  return true;
+}
+
+/**
+ * Compile one slot line.
+ *
+ * @return NULL, or why the line is wrong
+ */
+static const char *
+compile_slot (char **field, unsigned int num_fields,
+              struct config_layout *layout, uint16_t *named)
+{
+  static const uint8_t private_config[2] = { ECC_KEY_SLOT_CONFIG };
+  static const uint8_t clear_config[2] = { CLEAR_SLOT_CONFIG };
+  uint8_t slot_config[2];
+  uint8_t key_config[2] = { 0, 0 };
+  bool locked = false;
+  char *end = NULL;
+  long slot = 0;
+
+  if (num_fields > 3 && 0 == strcmp (field[num_fields - 1], "locked"))
+    {
+      locked = true;
+      num_fields--;
+    }
+
+  if (num_fields < 3)
+    return "usage: slot N private|public|data|raw [locked]";
+
+  slot = strtol (field[1], &end, 10);
+  if ('\0' == *field[1] || '\0' != *end || slot < 0 ||
+      slot >= MAX_NUM_DATA_SLOTS)
+    return "slot must be 0 to 15";
+
+  if (*named & (1 << slot))
+    return "slot named twice";
+
+  if (0 == strcmp (field[2], "raw"))
+    {
+      if (5 != num_fields || !parse_hex (field[3], slot_config, 2) ||
+          !parse_hex (field[4], key_config, 2))
+        return "usage: slot N raw SLOTCONFIG KEYCONFIG [locked]";
+    }
+  else if (3 != num_fields)
+    return "unexpected text after the slot kind";
+  else if (0 == strcmp (field[2], "private"))
+    {
+      memcpy (slot_config, private_config, sizeof (slot_config));
+      key_config[0] = KEY_CONFIG_P256_PRIVATE;
+    }
+  else if (0 == strcmp (field[2], "public"))
+    {
+      if (slot < PUB_KEY_MIN_SLOT)
+        return "public keys only fit in slots 8 and up";
+
+      memcpy (slot_config, clear_config, sizeof (slot_config));
+      key_config[0] = KEY_CONFIG_P256_PUBLIC;
+    }
+  else if (0 == strcmp (field[2], "data"))
+    {
+      memcpy (slot_config, clear_config, sizeof (slot_config));
+      key_config[0] = KEY_CONFIG_DATA;
+    }
+  else
+    return "unknown slot kind";
+
+  memcpy (layout->slot_config + 2 * slot, slot_config, sizeof (slot_config));
+  memcpy (layout->key_config + 2 * slot, key_config, sizeof (key_config));
+  if (locked)
+    layout->slot_locked[SLOT_LOCKED_OFFSET + slot / 8] &= ~(1 << (slot % 8));
+  *named |= 1 << slot;
+
+  return NULL;
+}
+
+bool profile_compile (FILE *in, const char *name,
+                      struct config_layout *layout)
+{
+  char *line = NULL;
+  size_t n = 0;
+  unsigned long num = 0;
+  uint16_t named = 0;
+  bool i2c_named = false;
+  bool temp_named = false;
+  bool result = true;
+
+  assert (NULL != in);
+  assert (NULL != layout);
+
+  *layout = DEFAULT_CONFIG_LAYOUT;
+
+  while (getline (&line, &n, in) >= 0)
+    {
+      char *field[PROFILE_MAX_FIELDS];
+      unsigned int num_fields = 0;
+      const char *error = NULL;
+      char *save = NULL;
+      char *comment = strchr (line, '#');
+      char *tok = NULL;
+
+      num++;
+
+      if (NULL != comment)
+        *comment = '\0';
+
+      for (tok = strtok_r (line, " \t\r\n", &save);
+           NULL != tok && num_fields < PROFILE_MAX_FIELDS;
+           tok = strtok_r (NULL, " \t\r\n", &save))
+        field[num_fields++] = tok;
+
+      if (0 == num_fields)
+        continue;
+
+      if (0 == strcmp (field[0], "slot"))
+        error = compile_slot (field, num_fields, layout, &named);
+      else if (0 == strcmp (field[0], "temp"))
+        {
+          if (temp_named)
+            error = "temp named twice";
+          else if (2 != num_fields ||
+                   !parse_hex (field[1], layout->slot_locked + TEMP_OFFSET, 4))
+            error = "usage: temp WORD";
+          else
+            temp_named = true;
+        }
+      else if (0 != strcmp (field[0], "i2c"))
+        error = "unknown keyword";
+      else if (i2c_named)
+        error = "i2c named twice";
+      else if (2 != num_fields || !parse_hex (field[1], layout->i2c, 4))
+        error = "usage: i2c WORD";
+      else
+        i2c_named = true;
+
+      if (NULL != error)
+        {
+          fprintf (stderr, "%s:%lu: %s\n", name, num, error);
+          result = false;
+        }
+    }
+
+  free (line);
+
+  return result;
+}
+
+static uint16_t
+image_crc (const struct profile_image *image)
+{
+  return lca_calculate_crc16 ((const uint8_t *)image,
+                              offsetof (struct profile_image, crc));
+}
+
+bool profile_save (const char *path, const struct config_layout *layout)
+{
+  struct profile_image image;
+  uint16_t crc = 0;
+  FILE *f = NULL;
+
+  assert (NULL != path);
+  assert (NULL != layout);
+
+  memset (&image, 0, sizeof (image));
+  strncpy (image.magic, PROFILE_MAGIC, sizeof (image.magic));
+  image.layout = *layout;
+
+  crc = image_crc (&image);
+  image.crc[0] = crc & 0xFF;
+  image.crc[1] = crc >> 8;
+
+  if (NULL == (f = fopen (path, "wb")))
+    {
+      perror (path);
+      return false;
+    }
+
+  if (1 != fwrite (&image, sizeof (image), 1, f))
+    {
+      perror (path);
+      fclose (f);
+      return false;
+    }
+
+  if (0 != fclose (f))
+    {
+      perror (path);
+      return false;
+    }
+
+  return true;
+}
+
+bool profile_load (const char *path, struct config_layout *layout)
+{
+  struct profile_image image;
+  char magic[PROFILE_MAGIC_LEN];
+  uint16_t crc = 0;
+  bool whole = false;
+  FILE *f = NULL;
+
+  assert (NULL != path);
+  assert (NULL != layout);
+
+  if (NULL == (f = fopen (path, "rb")))
+    {
+      perror (path);
+      return false;
+    }
+
+  whole = 1 == fread (&image, sizeof (image), 1, f) && EOF == fgetc (f);
+  fclose (f);
+
+  memset (magic, 0, sizeof (magic));
+  strncpy (magic, PROFILE_MAGIC, sizeof (magic));
+
+  if (!whole || 0 != memcmp (image.magic, magic, sizeof (magic)))
+    {
+      fprintf (stderr, "%s: %s\n", path,
+               "Not a compiled profile, see compile-profile");
+      return false;
+    }
+
+  crc = image_crc (&image);
+
+  if (image.crc[0] != (crc & 0xFF) || image.crc[1] != crc >> 8)
+    {
+      fprintf (stderr, "%s: %s\n", path, "Profile is corrupt");
+      return false;
+    }
+
+  *layout = image.layout;
+
+  return true;
+}
@@ -0,0 +1,76 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "config_zone.h"
+
+#define PROFILE_MAGIC "ECLET-PROFILE 1"
+#define PROFILE_MAGIC_LEN 16
+
+/* A compiled profile, as stored on disk.  Every member is bytes, so
+   the layout has no padding and is the same on every host. */
+struct profile_image
+{
+  char magic[PROFILE_MAGIC_LEN]; /**< PROFILE_MAGIC, zero padded */
+  struct config_layout layout;
+  uint8_t crc[2];               /**< CRC16 of the above, device order */
+};
+
+/**
+ * Compile a text profile into a layout.  Lines not mentioned keep
+ * DEFAULT_CONFIG_LAYOUT.  Errors are reported on stderr with the
+ * line number.
+ *
+ * @param in The profile text
+ * @param name The name used in error messages
+ * @param layout Filled with the layout
+ *
+ * @return true if every line was understood
+ */
+bool profile_compile (FILE *in, const char *name,
+                      struct config_layout *layout);
+
+/**
+ * Write the binary image of a layout.
+ *
+ * @param path The image to create
+ * @param layout The layout
+ *
+ * @return true on success
+ */
+bool profile_save (const char *path, const struct config_layout *layout);
+
+/**
+ * Read a binary image written by profile_save, checking its magic and
+ * CRC.
+ *
+ * @param path The image
+ * @param layout Filled with the layout
+ *
+ * @return true if the image is intact
+ */
+bool profile_load (const char *path, struct config_layout *layout);
+
+#endif /* PROFILE_H */
@@ -0,0 +1,67 @@
+#!/bin/bash
+# Copyright (C) 2014 Cryptotronix, LLC.
+
+# This file is part of EClet.
+
+# EClet is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+
+# EClet is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+
+# You should have received a copy of the GNU General Public License
+# along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+
+# Compares one process per signature against the daemon.  Requires a
+# personalized device with a key in slot 0 and socat.
+
+EXE=${EXE:-./eclet}
+COUNT=${COUNT:-100}
+SOCKDIR=$(mktemp -d)
+SOCK=$SOCKDIR/eclet.sock
+DATA=$(mktemp)
+
+echo "EClet daemon benchmark" > $DATA
+DIGEST=$(sha256sum $DATA | cut -d ' ' -f 1)
+
+now(){
+    date +%s.%N
+}
+
+rate(){
+    echo "$1 $2 $3" | awk '{ printf "%d signatures in %.3f s: %.1f sig/s\n", $1, $3 - $2, $1 / ($3 - $2) }'
+}
+
+START=$(now)
+for ((i = 0; i < COUNT; i++))
+do
+    $EXE sign -f $DATA > /dev/null || { echo sign failed; exit 1; }
+done
+echo -n "one process per signature: "
+rate $COUNT $START $(now)
+
+$EXE daemon --socket $SOCK &
+PID=$!
+while [[ ! -S $SOCK ]]; do sleep 0.1; done
+
+START=$(now)
+OK=$(yes "sign 0 $DIGEST" | head -n $COUNT | \
+    socat -t 30 - UNIX-CONNECT:$SOCK | grep -c '^OK')
+END=$(now)
+
+kill $PID
+wait $PID
+rm -f $DATA
+rm -rf $SOCKDIR
+
+if [[ $OK != $COUNT ]]; then
+    echo daemon signatures failed
+    exit 1
+fi
+
+echo -n "daemon:                    "
+rate $COUNT $START $END
@@ -0,0 +1,193 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file   bench_p256.c
+ *
+ * @brief  Compares the verifies per second of the built in P-256
+ * verifier, with and without precomputed tables, against
+ * libcryptoauth's.  Not built by default:
+ *
+ *   make bench_p256 && ./bench_p256 [SECONDS]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../crypto/p256.h"
+#include <libcryptoauth.h>
+
+#define BENCH_DEFAULT_SECS 2.0
+
+/* RFC 6979 A.2.5, P-256 with SHA-256 over "sample" */
+static const char *PUB_KEY =
+  "04"
+  "60FED4BA255A9D31C961EB74C6356D68C049B8923B61FA6CE669622E60F29FB6"
+  "7903FE1008B8BC99A41AE9E95628BC64F2F1B20C2D7E9F5177A3C294D4462299";
+static const char *SIGNATURE =
+  "EFD48B2AACB6A8FD1140DD9CD45E81D69D2C877B56AAF991C34D0EA84EAF3716"
+  "F7CB1C942D657C41D436C7A1B6E29F65F3E900DBB9AFF4064DC4AB2F843ACDA8";
+static const char *DIGEST =
+  "AF2BDBE1AA9B6EC1E2ADE1D694F41FC71A831D0268E9891562113D8A62ADD1BF";
+
+typedef bool (*verifier) (struct lca_octet_buffer pub_key,
+                          struct lca_octet_buffer signature,
+                          struct lca_octet_buffer digest);
+
+static bool
+p256_verify_buffers (struct lca_octet_buffer pub_key,
+                     struct lca_octet_buffer signature,
+                     struct lca_octet_buffer digest)
+{
+  return p256_verify (pub_key.ptr, signature.ptr, digest.ptr);
+}
+
+/* The tables the keyring would hold */
+static struct p256_table g_table;
+static struct p256_table q_table;
+
+static bool
+p256_verify_tables (struct lca_octet_buffer pub_key,
+                    struct lca_octet_buffer signature,
+                    struct lca_octet_buffer digest)
+{
+  return p256_verify_precomputed (&g_table, &q_table, signature.ptr,
+                                  digest.ptr);
+}
+
+static double
+now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Verify the good signature until secs have passed.
+ *
+ * @return Verifies per second, or 0 if any verify failed
+ */
+static double
+bench (verifier verify, struct lca_octet_buffer pub_key,
+       struct lca_octet_buffer signature, struct lca_octet_buffer digest,
+       double secs)
+{
+  double start = now ();
+  double elapsed = 0;
+  unsigned long count = 0;
+  unsigned int x = 0;
+
+  do
+    {
+      /* Only look at the clock every few verifies */
+      for (x = 0; x < 16; x++)
+        if (!verify (pub_key, signature, digest))
+          return 0;
+
+      count += x;
+      elapsed = now () - start;
+    }
+  while (elapsed < secs);
+
+  return count / elapsed;
+}
+
+/**
+ * Every verifier must accept the test vector and reject it with any
+ * of its inputs changed.  The tables already hold the key.
+ */
+static bool
+agree (verifier verify, struct lca_octet_buffer pub_key,
+       struct lca_octet_buffer signature, struct lca_octet_buffer digest,
+       bool uses_key)
+{
+  bool ok = verify (pub_key, signature, digest);
+
+  signature.ptr[40] ^= 1;
+  ok = ok && !verify (pub_key, signature, digest);
+  signature.ptr[40] ^= 1;
+
+  digest.ptr[0] ^= 1;
+  ok = ok && !verify (pub_key, signature, digest);
+  digest.ptr[0] ^= 1;
+
+  /* No longer on the curve */
+  pub_key.ptr[64] ^= 1;
+  ok = ok && (!uses_key || !verify (pub_key, signature, digest));
+  pub_key.ptr[64] ^= 1;
+
+  return ok;
+}
+
+int
+main (int argc, char **argv)
+{
+  struct lca_octet_buffer pub_key = lca_ascii_hex_2_bin (PUB_KEY, 130);
+  struct lca_octet_buffer signature = lca_ascii_hex_2_bin (SIGNATURE, 128);
+  struct lca_octet_buffer digest = lca_ascii_hex_2_bin (DIGEST, 64);
+  double secs = argc > 1 ? atof (argv[1]) : BENCH_DEFAULT_SECS;
+  double lca_rate = 0;
+  double p256_rate = 0;
+  double table_rate = 0;
+  int result = EXIT_FAILURE;
+
+  if (secs <= 0)
+    secs = BENCH_DEFAULT_SECS;
+
+  if (!agree (lca_ecdsa_p256_verify, pub_key, signature, digest, true))
+    fprintf (stderr, "%s\n", "libcryptoauth failed the test vector");
+  else if (!agree (p256_verify_buffers, pub_key, signature, digest, true))
+    fprintf (stderr, "%s\n", "p256 failed the test vector");
+  else if (!p256_precompute (p256_base_point, &g_table) ||
+           !p256_precompute (pub_key.ptr, &q_table))
+    fprintf (stderr, "%s\n", "p256 failed to build the tables");
+  else if (!agree (p256_verify_tables, pub_key, signature, digest, false))
+    fprintf (stderr, "%s\n", "p256 with tables failed the test vector");
+  else
+    {
+      lca_rate = bench (lca_ecdsa_p256_verify, pub_key, signature, digest,
+                        secs);
+      p256_rate = bench (p256_verify_buffers, pub_key, signature, digest,
+                         secs);
+      table_rate = bench (p256_verify_tables, pub_key, signature, digest,
+                          secs);
+
+      printf ("host (libcryptoauth): %10.1f verifies/s\n", lca_rate);
+      printf ("p256:                 %10.1f verifies/s\n", p256_rate);
+      printf ("p256 with tables:     %10.1f verifies/s\n", table_rate);
+
+      if (lca_rate > 0)
+        printf ("speed up:             %10.1fx, %.1fx with tables\n",
+                p256_rate / lca_rate, table_rate / lca_rate);
+
+      result = EXIT_SUCCESS;
+    }
+
+  lca_free_octet_buffer (digest);
+  lca_free_octet_buffer (signature);
+  lca_free_octet_buffer (pub_key);
+
+  return result;
+}
@@ -0,0 +1,293 @@
+/* -*- mode: c; c-file-style: "gnu" -*-
+ * Copyright (C) 2014 Cryptotronix, LLC.
+ *
+ * This file is part of EClet.
+ *
+ * EClet is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * EClet is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EClet.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file   kat_sha256.c
+ *
+ * @brief  Runs the FIPS 180-2 SHA-256 known answers through every
+ * block engine and multi-buffer engine this CPU supports, the ones
+ * ECLET_SHA256_ENGINE and ECLET_SHA256_MB_ENGINE can select.  Engines
+ * the CPU lacks are reported and skipped.  Not built by default:
+ *
+ *   make kat_sha256 && ./kat_sha256
+ *
+ * The exit code is non-zero if any engine gives a wrong digest.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../crypto/sha256.h"
+#include "../crypto/sha256_mb.h"
+
+/* Messages of every length up to here cover one and two padding
+   blocks and unequal lanes in the multi-buffer engines */
+#define KAT_PATTERN_MAX_LEN 200
+
+struct kat
+{
+  const char *msg;
+  unsigned long repeat;         /**< Times msg is repeated */
+  const char *digest;
+};
+
+/* FIPS 180-2 appendix B, with the empty message and the FIPS 180-4
+   two block example */
+static const struct kat kats[] =
+  {
+    { "", 1,
+      "E3B0C44298FC1C149AFBF4C8996FB92427AE41E4649B934CA495991B7852B855" },
+    { "abc", 1,
+      "BA7816BF8F01CFEA414140DE5DAE2223B00361A396177A9CB410FF61F20015AD" },
+    { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1,
+      "248D6A61D20638B8E5C026930C3E6039A33CE45964FF2167F6ECEDD419DB06C1" },
+    { "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+      "hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu", 1,
+      "CF5B16A778AF8380036CE59E7B0492370B249B11E8F07A51AFAC45037AFEE9D1" },
+    { "a", 1000000,
+      "CDC76E5C9914FB9281A1C7E284D73E67F1809A48A497200E046D39CCC7112CD0" }
+  };
+
+#define NUM_KATS (sizeof (kats) / sizeof (kats[0]))
+
+/* RFC 4231 test case 2, since the caches' MACs ride on the engine */
+static const char *HMAC_KEY = "Jefe";
+static const char *HMAC_DATA = "what do ya want for nothing?";
+static const char *HMAC_MAC =
+  "5BDCC146BF60754E6A042426089575C75A003F089D2739839DEC58B964EC3843";
+
+static const char *engines[] = { "shani", "armv8", "portable" };
+static const char *mb_engines[] = { "avx512", "avx2", "sse2", "generic",
+                                    "none" };
+
+#define NUM_ENGINES (sizeof (engines) / sizeof (engines[0]))
+#define NUM_MB_ENGINES (sizeof (mb_engines) / sizeof (mb_engines[0]))
+
+/* The messages, built once */
+static uint8_t *msgs[NUM_KATS + KAT_PATTERN_MAX_LEN + 1];
+static size_t lens[NUM_KATS + KAT_PATTERN_MAX_LEN + 1];
+
+#define NUM_MSGS (sizeof (msgs) / sizeof (msgs[0]))
+
+/* Each message's digest from the first engine that passed the known
+   answers, what the pattern messages are checked against */
+static uint8_t expected[NUM_MSGS][SHA256_DIGEST_LEN];
+static bool have_expected = false;
+
+static bool
+matches (const uint8_t *digest, const char *hex)
+{
+  char got[2 * SHA256_DIGEST_LEN + 1];
+  unsigned int x = 0;
+
+  for (x = 0; x < SHA256_DIGEST_LEN; x++)
+    snprintf (got + 2 * x, 3, "%02X", digest[x]);
+
+  return 0 == strcmp (got, hex);
+}
+
+static void
+build_messages (void)
+{
+  unsigned int x = 0;
+  unsigned long r = 0;
+
+  for (x = 0; x < NUM_KATS; x++)
+    {
+      size_t len = strlen (kats[x].msg);
+
+      lens[x] = len * kats[x].repeat;
+      if ((msgs[x] = malloc (lens[x] + 1)) == NULL)
+        exit (2);
+
+      for (r = 0; r < kats[x].repeat; r++)
+        memcpy (msgs[x] + r * len, kats[x].msg, len);
+    }
+
+  for (x = 0; x <= KAT_PATTERN_MAX_LEN; x++)
+    {
+      unsigned int y = 0;
+
+      lens[NUM_KATS + x] = x;
+      if ((msgs[NUM_KATS + x] = malloc (x + 1)) == NULL)
+        exit (2);
+
+      for (y = 0; y < x; y++)
+        msgs[NUM_KATS + x][y] = (uint8_t)(31 * x + 7 * y);
+    }
+}
+
+/**
+ * Hash in uneven pieces, so the partial block buffer is exercised.
+ */
+static void
+sha256_pieces (const uint8_t *data, size_t len, uint8_t *digest)
+{
+  static const size_t pieces[] = { 1, 3, 63, 64, 65, 127, 1000, 4096 };
+  struct sha256_ctx ctx;
+  size_t done = 0;
+  unsigned int x = 0;
+
+  sha256_init (&ctx);
+
+  while (done < len)
+    {
+      size_t n = pieces[x++ % (sizeof (pieces) / sizeof (pieces[0]))];
+
+      if (n > len - done)
+        n = len - done;
+
+      sha256_update (&ctx, data + done, n);
+      done += n;
+    }
+
+  sha256_final (&ctx, digest);
+}
+
+static bool
+check_engine (const char *name)
+{
+  uint8_t digest[SHA256_DIGEST_LEN];
+  uint8_t pieces[SHA256_DIGEST_LEN];
+  bool ok = true;
+  unsigned int differ = 0;
+  unsigned int x = 0;
+
+  for (x = 0; x < NUM_KATS; x++)
+    {
+      sha256 (msgs[x], lens[x], digest);
+      sha256_pieces (msgs[x], lens[x], pieces);
+
+      if (!matches (digest, kats[x].digest) ||
+          !matches (pieces, kats[x].digest))
+        {
+          printf ("sha256 %s: known answer %u failed\n", name, x);
+          ok = false;
+        }
+    }
+
+  hmac_sha256 ((const uint8_t *)HMAC_KEY, strlen (HMAC_KEY), HMAC_DATA,
+               strlen (HMAC_DATA), digest);
+
+  if (!matches (digest, HMAC_MAC))
+    {
+      printf ("sha256 %s: HMAC known answer failed\n", name);
+      ok = false;
+    }
+
+  for (x = NUM_KATS; x < NUM_MSGS; x++)
+    {
+      sha256 (msgs[x], lens[x], digest);
+      sha256_pieces (msgs[x], lens[x], pieces);
+
+      if (0 != memcmp (digest, pieces, sizeof (digest)) ||
+          (have_expected && 0 != memcmp (digest, expected[x],
+                                         sizeof (digest))))
+        differ++;
+      else if (!have_expected && ok)
+        memcpy (expected[x], digest, sizeof (digest));
+    }
+
+  if (differ > 0)
+    {
+      printf ("sha256 %s: %u of %u pattern messages differ\n", name,
+              differ, KAT_PATTERN_MAX_LEN + 1);
+      ok = false;
+    }
+
+  if (ok)
+    have_expected = true;
+
+  return ok;
+}
+
+static bool
+check_mb_engine (const char *name)
+{
+  static uint8_t digests[NUM_MSGS][SHA256_DIGEST_LEN];
+  bool ok = true;
+  unsigned int differ = 0;
+  unsigned int x = 0;
+
+  sha256_mb ((const uint8_t *const *)msgs, lens, digests, NUM_MSGS);
+
+  for (x = 0; x < NUM_KATS; x++)
+    if (!matches (digests[x], kats[x].digest))
+      {
+        printf ("sha256_mb %s: known answer %u failed\n", name, x);
+        ok = false;
+      }
+
+  for (x = NUM_KATS; x < NUM_MSGS; x++)
+    if (0 != memcmp (digests[x], expected[x], SHA256_DIGEST_LEN))
+      differ++;
+
+  if (differ > 0)
+    {
+      printf ("sha256_mb %s: %u of %u pattern messages differ\n", name,
+              differ, KAT_PATTERN_MAX_LEN + 1);
+      ok = false;
+    }
+
+  return ok;
+}
+
+int
+main (void)
+{
+  bool ok = true;
+  unsigned int x = 0;
+
+  build_messages ();
+
+  for (x = 0; x < NUM_ENGINES; x++)
+    {
+      if (!sha256_set_engine (engines[x]))
+        printf ("sha256 %-10s not supported here, skipped\n", engines[x]);
+      else if (check_engine (engines[x]))
+        printf ("sha256 %-10s ok\n", engines[x]);
+      else
+        ok = false;
+    }
+
+  if (!have_expected)
+    {
+      printf ("%s\n", "No block engine passed, multi-buffer not checked");
+      return 1;
+    }
+
+  for (x = 0; x < NUM_MB_ENGINES; x++)
+    {
+      if (!sha256_mb_set_engine (mb_engines[x]))
+        printf ("sha256_mb %-7s not supported here, skipped\n",
+                mb_engines[x]);
+      else if (check_mb_engine (mb_engines[x]))
+        printf ("sha256_mb %-7s ok, %u lane%s\n", mb_engines[x],
+                sha256_mb_lanes (), 1 == sha256_mb_lanes () ? "" : "s");
+      else
+        ok = false;
+    }
+
+  for (x = 0; x < NUM_MSGS; x++)
+    free (msgs[x]);
+
+  return ok ? 0 : 1;
+}